@@ -0,0 +1,211 @@
+#include "ai.h"
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr double LOST = -1e9; // score of a placement that tops out
+
+int popcount(Row r){
+    return static_cast<int>(std::bitset<32>(r).count());
+}
+
+} // namespace
+
+Ai::Ai(unsigned threads){
+    if(threads != 1)
+        pool = std::make_unique<ThreadPool>(threads);
+}
+
+void Ai::use_tt(std::size_t megabytes){
+    if(megabytes) tt = std::make_unique<TranspositionTable>(megabytes);
+    else tt.reset();
+}
+
+bool Ai::load_weights(const char* path, Weights& w){
+    std::FILE* fp = std::fopen(path, "r");
+    if(!fp) return false;
+    Weights loaded = w;
+    char name[32];
+    double value;
+    bool ok = true;
+    while(ok && std::fscanf(fp, "%31s %lf", name, &value) == 2){
+        if(!std::strcmp(name, "height")) loaded.height = value;
+        else if(!std::strcmp(name, "lines")) loaded.lines = value;
+        else if(!std::strcmp(name, "holes")) loaded.holes = value;
+        else if(!std::strcmp(name, "bumpiness")) loaded.bumpiness = value;
+        else ok = false;
+    }
+    ok = ok && std::feof(fp);
+    std::fclose(fp);
+    if(ok) w = loaded;
+    return ok;
+}
+
+bool Ai::save_weights(const char* path, const Weights& w){
+    std::FILE* fp = std::fopen(path, "w");
+    if(!fp) return false;
+    std::fprintf(fp, "height %.9g\nlines %.9g\nholes %.9g\nbumpiness %.9g\n",
+                 w.height, w.lines, w.holes, w.bumpiness);
+    return std::fclose(fp) == 0;
+}
+
+Ai::State Ai::snapshot(const Game& g){
+    State s;
+    s.field = g.field;
+    s.hash = g.board_hash;
+    // the bag order is already decided, so the search may look past `nxt`
+    s.queue[s.known++] = g.cur;
+    s.queue[s.known++] = g.nxt;
+    for(size_t i=g.bag_pos; i<g.bag.size() && s.known<MAX_DEPTH; ++i)
+        s.queue[s.known++] = g.bag[i];
+    return s;
+}
+
+int Ai::place(Game::Field& f, const Game::Skyline& top, const Shape& s, int x,
+              std::uint64_t* hash){
+    int y = Game::landing_row(top, s, x, 0);
+    if(y < 0){
+        y = 0;
+        while(!Game::collides(f, s, x, y+1)) ++y;
+    }
+    for(int i=0;i<4;++i){
+        if(!s.rows[i]) continue;
+        Row bits = s.rows[i] << (x + Game::WALL);
+        f[y+i] |= bits;
+        if(hash) *hash ^= Game::row_hash(y+i, bits);
+    }
+
+    int dest = Game::H-1;
+    for(int r = Game::H-1; r >= 0; --r){
+        if(f[r] == Game::FULL_ROW){
+            if(hash) *hash ^= Game::row_hash(r, f[r]);
+            continue;
+        }
+        if(hash && dest != r && f[r] != Game::EMPTY_ROW) *hash ^= Game::row_move_hash(r, dest, f[r]);
+        f[dest--] = f[r];
+    }
+    for(int r = dest; r >= 0; --r) f[r] = Game::EMPTY_ROW;
+    return dest + 1;
+}
+
+double Ai::evaluate(const Game::Field& f, int lines, const Weights& w){
+    // walk rows top-down: `seen` holds the columns whose top is above us,
+    // so every empty cell under a seen column is a hole
+    std::array<int,Game::W> heights{};
+    Row seen = 0;
+    int holes = 0;
+    for(int r=0;r<Game::H;++r){
+        Row occ = f[r] & Game::BOARD_BITS;
+        Row tops = occ & ~seen;
+        while(tops){
+            int bit = 0;
+            while(!(tops & (Row(1) << bit))) ++bit;
+            heights[bit - Game::WALL] = Game::H - r;
+            tops &= tops - 1;
+        }
+        seen |= occ;
+        holes += popcount(seen & ~occ);
+    }
+    int aggregate = 0, bumpiness = 0;
+    for(int c=0;c<Game::W;++c){
+        aggregate += heights[c];
+        if(c) bumpiness += std::abs(heights[c] - heights[c-1]);
+    }
+    return w.height * aggregate + w.lines * lines +
+           w.holes * holes + w.bumpiness * bumpiness;
+}
+
+double Ai::search(const Game::Field& f, std::uint64_t hash, const State& st,
+                  int ply, int plies, Counters& c) const
+{
+    int piece = st.queue[ply];
+    if(Game::collides(f, Game::shape(piece, 0), SPAWN_X, 0)) return LOST;
+
+    // a node is the board plus the pieces still to be placed below it
+    int remaining = plies - ply;
+    std::uint64_t key = hash;
+    TranspositionTable::Entry e;
+    if(tt){
+        for(int i=0;i<remaining;++i) key ^= Game::piece_key(i, st.queue[ply+i]);
+        ++c.probes;
+        if(tt->probe(key, remaining, e)){
+            ++c.hits;
+            return e.score;
+        }
+    }
+
+    double best = LOST;
+    int best_x = SPAWN_X, best_r = 0;
+    Game::Skyline top;
+    Game::skyline(f, top);
+    for_each_placement(f, piece, [&](int x,int r){
+        Game::Field child = f;
+        std::uint64_t child_hash = hash;
+        int lines = place(child, top, Game::shape(piece, r), x, tt ? &child_hash : nullptr);
+        ++c.nodes;
+        double sc = weights.lines * lines +
+            (remaining == 1 ? evaluate(child, 0, weights)
+                            : search(child, child_hash, st, ply+1, plies, c));
+        if(sc > best){
+            best = sc;
+            best_x = x;
+            best_r = r;
+        }
+    });
+
+    if(tt) tt->store(key, {static_cast<float>(best), remaining, best_x, best_r});
+    return best;
+}
+
+Ai::Move Ai::choose(const State& st){
+    std::array<Move,MAX_PLACEMENTS> first{};
+    int count = 0;
+    for_each_placement(st.field, st.queue[0], [&](int x,int r){
+        if(count < MAX_PLACEMENTS) first[count++] = Move{x, r, 0, true};
+    });
+
+    // the score of a root move is lines it clears plus the best line of play below it
+    int plies = std::max(1, std::min({depth, st.known, MAX_DEPTH}));
+    std::array<Counters,MAX_PLACEMENTS> counters{};
+    Game::Skyline top;
+    Game::skyline(st.field, top);
+    auto run = [&](std::size_t i){
+        Move& m = first[i];
+        Counters& c = counters[i];
+        Game::Field f = st.field;
+        std::uint64_t h = st.hash;
+        int lines = place(f, top, Game::shape(st.queue[0], m.r), m.x, tt ? &h : nullptr);
+        c.nodes = 1;
+        m.score = weights.lines * lines +
+            (plies == 1 ? evaluate(f, 0, weights) : search(f, h, st, 1, plies, c));
+    };
+
+    if(pool && plies >= 2){
+        pool->parallel_for(count, run);
+    } else {
+        for(int i=0;i<count;++i) run(i);
+    }
+
+    Move best{};
+    for(int i=0;i<count;++i){
+        nodes += counters[i].nodes;
+        tt_probes += counters[i].probes;
+        tt_hits += counters[i].hits;
+        if(!best.valid || first[i].score > best.score) best = first[i];
+    }
+    ++decisions;
+    return best;
+}
+
+void Ai::apply(Game& g, const Move& m){
+    if(!m.valid) return;
+    g.try_move(0, 0, (m.r - g.pr + 4) % 4);
+    while(g.px < m.x && !g.collides(g.px+1, g.py, g.pr)) g.try_move(1, 0, 0);
+    while(g.px > m.x && !g.collides(g.px-1, g.py, g.pr)) g.try_move(-1, 0, 0);
+    g.hard_drop();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "game.h"
+#include "thread_pool.h"
+#include "tt.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+
+// Placement search for autoplay and headless tools: enumerates every
+// reachable (x, rotation) of the current piece and recursively of the
+// pieces after it, and scores the resulting boards with a weighted
+// heuristic. Root placements are spread over a work-stealing pool; an
+// optional transposition table shared by all threads caches subtrees.
+struct Ai {
+    static constexpr int MAX_DEPTH = 4;
+
+    // the part of Game the search needs; trivially copyable, ~130 bytes
+    struct State {
+        Game::Field field;
+        std::uint64_t hash = 0;             // Zobrist hash of field
+        std::array<int,MAX_DEPTH> queue{};  // current, next, then the rest of the bag
+        int known = 0;                      // valid entries in queue
+    };
+
+    struct Weights {
+        double height    = -0.510066; // aggregate column height
+        double lines     =  0.760666; // lines cleared by the placements
+        double holes     = -0.35663;  // empty cells below a column top
+        double bumpiness = -0.184483; // sum of neighbour height differences
+    };
+
+    struct Move {
+        int x = 0, r = 0;
+        double score = 0;
+        bool valid = false;
+    };
+
+    Weights weights;
+    int depth = 2;          // pieces to look at, capped by MAX_DEPTH and the known queue
+    long long nodes = 0;    // boards evaluated so far
+    long long decisions = 0;
+    long long tt_probes = 0;
+    long long tt_hits = 0;
+
+    explicit Ai(unsigned threads = 0); // 0 = every core, 1 = search inline
+
+    // cache subtree scores in a table of the given size; 0 turns it off
+    void use_tt(std::size_t megabytes);
+    std::size_t tt_bytes() const { return tt ? tt->bytes() : 0; }
+    double tt_hit_rate() const { return tt_probes ? double(tt_hits) / tt_probes : 0.0; }
+
+    // weights file: one "name value" pair per line (height, lines, holes, bumpiness)
+    static bool load_weights(const char* path, Weights& w);
+    static bool save_weights(const char* path, const Weights& w);
+
+    static State snapshot(const Game& g);
+    Move choose(const State& s);
+    Move choose(const Game& g) { return choose(snapshot(g)); }
+
+    // rotate, slide and hard-drop the active piece to the chosen placement
+    static void apply(Game& g, const Move& m);
+
+    // drop shape at column x from the spawn row and clear full rows, keeping
+    // an optional Zobrist hash in sync; returns cleared line count. `top` is
+    // the skyline of f, shared by every placement tried on the same board.
+    static int place(Game::Field& f, const Game::Skyline& top, const Shape& s, int x,
+                     std::uint64_t* hash = nullptr);
+    static double evaluate(const Game::Field& f, int lines, const Weights& w);
+
+    // call fn(x, r) for every placement reachable from spawn: rotate in place,
+    // then slide along the spawn row; duplicate rotations (O, Dot) are skipped
+    template<class Fn>
+    static void for_each_placement(const Game::Field& f, int piece, Fn fn){
+        for(int r=0;r<4;++r){
+            const Shape& s = Game::shape(piece, r);
+            bool dup = false;
+            for(int k=0;k<r && !dup;++k)
+                dup = Game::shape(piece, k).rows == s.rows;
+            if(dup || Game::collides(f, s, SPAWN_X, 0)) continue;
+            for(int x=SPAWN_X; !Game::collides(f, s, x, 0); --x) fn(x, r);
+            for(int x=SPAWN_X+1; !Game::collides(f, s, x, 0); ++x) fn(x, r);
+        }
+    }
+
+    static constexpr int SPAWN_X = Game::SPAWN_X;
+    static constexpr int MAX_PLACEMENTS = 64;
+
+private:
+    struct Counters { long long nodes = 0, probes = 0, hits = 0; };
+
+    // best score reachable below a node whose next piece is queue[ply]
+    double search(const Game::Field& f, std::uint64_t hash, const State& st,
+                  int ply, int plies, Counters& c) const;
+
+    std::unique_ptr<ThreadPool> pool; // null when searching inline
+    std::unique_ptr<TranspositionTable> tt;
+};
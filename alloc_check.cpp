@@ -0,0 +1,94 @@
+//
+// Allocation check: replaces the global operator new to count heap
+// allocations, plays games through the per-piece engine path and fails if
+// anything allocates once the game has started.
+//
+#include "ai.h"
+#include "game.h"
+#include "trace.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+
+std::atomic<long long> allocations{0};
+std::atomic<long long> allocated_bytes{0};
+
+void* counted_alloc(std::size_t size){
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    if(void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return counted_alloc(size); }
+void* operator new[](std::size_t size) { return counted_alloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv){
+    int games = 50;
+    int max_pieces = 2000;
+    for(int i=1;i<argc;++i){
+        if(!std::strcmp(argv[i], "--games") && i+1 < argc)
+            games = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--max-pieces") && i+1 < argc)
+            max_pieces = std::atoi(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--games N] [--max-pieces N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Game::clock::time_point sim{};
+    Game game;
+    game.set_time(sim);
+    game.init(1);
+    Ai ai(1);
+    ai.depth = 1;
+    TRACE_THREAD();   // tracing builds: this thread's ring is setup, not play
+
+    long long setup = allocations.load();
+    long long setup_bytes = allocated_bytes.load();
+    long long pieces = 0;
+    for(int g=0; g<games; ++g){
+        game.set_time(sim);
+        game.reset();
+        for(int n=0; n<max_pieces && !game.over; ++n){
+            // every per-piece entry point: moves, soft/hard drop, lock delay, clears
+            Ai::Move m = ai.choose(game);
+            game.try_move(0, 0, 1);
+            game.try_move(0, 0, -1);
+            game.soft_drop();
+            Ai::apply(game, m);
+            game.check_and_lock();
+            sim += Game::LOCK_DELAY;
+            game.set_time(sim);
+            game.tick();
+            sim += Game::FLASH_TIME;
+            game.set_time(sim);
+            game.update_flash();
+            ++pieces;
+        }
+    }
+    long long steady = allocations.load() - setup;
+    long long steady_bytes = allocated_bytes.load() - setup_bytes;
+
+    std::printf("setup allocations:  %lld\n", setup);
+    std::printf("pieces played:      %lld\n", pieces);
+    std::printf("steady allocations: %lld (%lld bytes)\n",
+                steady, steady_bytes);
+    if(steady != 0){
+        std::printf("FAIL: the per-piece path allocated\n");
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
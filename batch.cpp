@@ -0,0 +1,152 @@
+#include "batch.h"
+#include <algorithm>
+
+BatchGame::BatchGame(std::size_t n, std::uint64_t seed)
+    : n(n),
+      seed(seed),
+      board(static_cast<std::size_t>(Game::H) * n),
+      cur(n), nxt(n),
+      score(n), level(n), total_lines(n),
+      cleared(n),
+      spawn(4 * n),
+      blocked(n),
+      bag(static_cast<std::size_t>(Game::PIECE_COUNT) * n),
+      bag_pos(n),
+      rng(n)
+{
+    reset_all();
+}
+
+void BatchGame::reset_all(){
+    for(std::size_t b=0;b<n;++b){
+        rng[b].seed(seed, b); // one PCG stream per board
+        reset_board(b);
+    }
+}
+
+void BatchGame::reset_board(std::size_t b){
+    for(int r=0;r<Game::H;++r) board[r*n + b] = Game::EMPTY_ROW;
+    score[b] = 0;
+    level[b] = 1;
+    total_lines[b] = 0;
+    bag_pos[b] = Game::PIECE_COUNT; // refill on first draw
+    cur[b] = draw_piece(b);
+    nxt[b] = draw_piece(b);
+}
+
+int BatchGame::draw_piece(std::size_t b){
+    std::uint8_t* own = &bag[b * Game::PIECE_COUNT];
+    if(bag_pos[b] >= Game::PIECE_COUNT){
+        for(int i=0;i<Game::PIECE_COUNT;++i) own[i] = static_cast<std::uint8_t>(i);
+        rng[b].shuffle(own, own + Game::PIECE_COUNT);
+        bag_pos[b] = 0;
+    }
+    return own[bag_pos[b]++];
+}
+
+bool BatchGame::collides(std::size_t b, const Shape& s, int x, int y) const{
+    int shift = x + Game::WALL;
+    if(shift < 0 || shift > 32 - 4) return true;
+    for(int i=0;i<4;++i){
+        if(!s.rows[i]) continue;
+        int gy = y + i;
+        if(gy < 0 || gy >= Game::H) return true;
+        if(board[gy*n + b] & (s.rows[i] << shift)) return true;
+    }
+    return false;
+}
+
+void BatchGame::stage_spawn(std::size_t b, const Shape& s){
+    for(int i=0;i<4;++i)
+        spawn[i*n + b] = s.rows[i] << (Game::SPAWN_X + Game::WALL);
+}
+
+// collides() at the spawn position for every board: the masks staged in
+// spawn[] against board rows 0..3, one contiguous pass per row
+void BatchGame::test_spawn(){
+    std::fill(blocked.begin(), blocked.end(), 0);
+    for(int i=0;i<4;++i){
+        const Row* row = &board[i*n];
+        const Row* piece = &spawn[i*n];
+        std::uint8_t* out = blocked.data();
+        for(std::size_t b=0;b<n;++b)
+            out[b] |= (row[b] & piece[b]) != 0;
+    }
+}
+
+void BatchGame::step(const int* actions, float* rewards, std::uint8_t* dones){
+    // 1. can each piece rotate in place at spawn? (all boards at once)
+    for(std::size_t b=0;b<n;++b){
+        int a = std::clamp(actions[b], 0, ACTIONS - 1);
+        stage_spawn(b, Game::shape(cur[b], a / COLUMNS));
+    }
+    test_spawn();
+
+    // 2. move and drop every active piece (per board, data dependent)
+    for(std::size_t b=0;b<n;++b){
+        int a = std::clamp(actions[b], 0, ACTIONS - 1);
+        int r = blocked[b] ? 0 : a / COLUMNS;
+        int x = a % COLUMNS - X_OFFSET;
+        const Shape* s = &Game::shape(cur[b], r);
+
+        int px = Game::SPAWN_X;
+        while(px < x && !collides(b, *s, px+1, 0)) ++px;
+        while(px > x && !collides(b, *s, px-1, 0)) --px;
+        int py = 0;
+        while(!collides(b, *s, px, py+1)) ++py;
+        for(int i=0;i<4;++i)
+            if(s->rows[i]) board[(py+i)*n + b] |= s->rows[i] << (px + Game::WALL);
+    }
+
+    // 3. count full rows of all boards at once; each pass is contiguous in b
+    std::fill(cleared.begin(), cleared.end(), 0);
+    for(int r=0;r<Game::H;++r){
+        const Row* row = &board[r*n];
+        std::uint8_t* out = cleared.data();
+        for(std::size_t b=0;b<n;++b)
+            out[b] += row[b] == Game::FULL_ROW;
+    }
+
+    // 4. compact, score and draw the next piece
+    for(std::size_t b=0;b<n;++b){
+        rewards[b] = 0;
+        dones[b] = 0;
+        if(int lines = cleared[b]){
+            int dest = Game::H-1;
+            for(int r = Game::H-1; r >= 0; --r){
+                Row row = board[r*n + b];
+                if(row == Game::FULL_ROW) continue;
+                board[(dest--)*n + b] = row;
+            }
+            for(int r = dest; r >= 0; --r) board[r*n + b] = Game::EMPTY_ROW;
+
+            int gained = Game::line_score(lines, level[b]);
+            score[b] += gained;
+            total_lines[b] += lines;
+            level[b] = Game::level_for_lines(total_lines[b]);
+            rewards[b] = static_cast<float>(gained);
+        }
+
+        cur[b] = nxt[b];
+        nxt[b] = draw_piece(b);
+        stage_spawn(b, Game::shape(cur[b], 0));
+    }
+
+    // 5. a board whose new piece does not fit has topped out
+    test_spawn();
+    for(std::size_t b=0;b<n;++b){
+        if(!blocked[b]) continue;
+        dones[b] = 1;
+        reset_board(b);
+    }
+}
+
+void BatchGame::observe(std::uint8_t* out) const{
+    for(std::size_t b=0;b<n;++b)
+        for(int r=0;r<Game::H;++r){
+            Row row = board[r*n + b];
+            std::uint8_t* dst = out + (b*Game::H + r)*Game::W;
+            for(int c=0;c<Game::W;++c)
+                dst[c] = static_cast<std::uint8_t>((row >> (c + Game::WALL)) & 1);
+        }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "game.h"
+#include "rng.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lockstep environment for reinforcement learning: N independent games
+// stepped together from an action array. State is struct-of-arrays; board
+// rows are stored row-major across boards (rows[r*n + b]) so the per-row
+// passes (full-row detection, spawn checks) run over contiguous memory and
+// vectorize across boards. Sliding and dropping stay a per-board loop: how
+// far a piece travels depends on that board. Scoring and level-ups follow
+// Game::lock_piece.
+//
+// An action is a placement: rotation r and column x of the piece origin,
+// encoded as r*COLUMNS + (x + X_OFFSET). The piece is rotated, slid along the
+// spawn row towards x until blocked (like the keyboard would) and dropped.
+// A board that tops out reports done=1 and is reset in the same step.
+class BatchGame {
+public:
+    static constexpr int X_OFFSET = 3;  // leftmost origin that can still be on the board
+    static constexpr int COLUMNS = Game::W + X_OFFSET;
+    static constexpr int ACTIONS = 4 * COLUMNS;
+
+    static constexpr int action(int x,int r) { return r*COLUMNS + x + X_OFFSET; }
+
+    BatchGame(std::size_t n, std::uint64_t seed);
+
+    std::size_t size() const { return n; }
+    void reset_all();
+
+    // actions: n entries; rewards: score gained; dones: 1 when the board topped out
+    void step(const int* actions, float* rewards, std::uint8_t* dones);
+
+    // row masks of all boards, rows[r*size() + b]; see Game::Field for the bit layout
+    const Row* rows() const { return board.data(); }
+    const int* current() const { return cur.data(); }
+    const int* next() const { return nxt.data(); }
+    const int* scores() const { return score.data(); }
+    const int* lines() const { return total_lines.data(); }
+
+    // dense 0/1 occupancy, out[(b*H + r)*W + c]
+    void observe(std::uint8_t* out) const;
+
+private:
+    void reset_board(std::size_t b);
+    int draw_piece(std::size_t b);
+    bool collides(std::size_t b, const Shape& s, int x, int y) const;
+    void stage_spawn(std::size_t b, const Shape& s);
+    void test_spawn();
+
+    std::size_t n;
+    std::uint64_t seed;
+    std::vector<Row> board;           // H*n
+    std::vector<int> cur, nxt;
+    std::vector<int> score, level, total_lines;
+    std::vector<std::uint8_t> cleared; // per-step scratch: lines cleared per board
+    std::vector<Row> spawn;            // per-step scratch: 4*n piece masks at the spawn position
+    std::vector<std::uint8_t> blocked; // per-step scratch: staged piece overlaps the board
+    std::vector<std::uint8_t> bag;     // PIECE_COUNT*n
+    std::vector<std::uint8_t> bag_pos;
+    std::vector<Rng> rng;
+};
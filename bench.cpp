@@ -0,0 +1,164 @@
+//
+// Headless self-play throughput benchmark: drives many games through the
+// engine with a simulated clock. The default policy is the greedy one-piece
+// search; --depth 2..4 switches to the multi-threaded lookahead, optionally
+// backed by a transposition table (--tt MB). --batch N measures the
+// lockstep BatchGame environment instead.
+//
+#include "ai.h"
+#include "batch.h"
+#include "game.h"
+#include "replay.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int games = 2000;
+    int max_pieces = 1000; // cap per game so a lucky policy can't run forever
+    int depth = 1;
+    unsigned threads = 0;
+    int tt_mb = 0;
+    const char* weights = nullptr;
+    int batch = 0;          // > 0: step a BatchGame of this many boards instead
+    int steps = 1000;
+    std::uint64_t seed = 1;
+    const char* record_dir = nullptr; // write one replay per game here
+};
+
+Options parse(int argc, char** argv){
+    Options opt;
+    for(int i=1;i<argc;++i){
+        if(!std::strcmp(argv[i], "--games") && i+1 < argc)
+            opt.games = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--max-pieces") && i+1 < argc)
+            opt.max_pieces = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--depth") && i+1 < argc)
+            opt.depth = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--threads") && i+1 < argc)
+            opt.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if(!std::strcmp(argv[i], "--tt") && i+1 < argc)
+            opt.tt_mb = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--weights") && i+1 < argc)
+            opt.weights = argv[++i];
+        else if(!std::strcmp(argv[i], "--batch") && i+1 < argc)
+            opt.batch = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--steps") && i+1 < argc)
+            opt.steps = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--seed") && i+1 < argc)
+            opt.seed = std::strtoull(argv[++i], nullptr, 0);
+        else if(!std::strcmp(argv[i], "--record-dir") && i+1 < argc)
+            opt.record_dir = argv[++i];
+        else {
+            std::fprintf(stderr,
+                "usage: %s [--games N] [--max-pieces N] [--depth 1-4] [--threads N] [--tt MB]\n"
+                "          [--weights FILE] [--batch N --steps N] [--seed N] [--record-dir DIR]\n",
+                argv[0]);
+            std::exit(2);
+        }
+    }
+    return opt;
+}
+
+// lockstep environment throughput with pseudo-random placement actions
+int run_batch(const Options& opt){
+    BatchGame env(static_cast<std::size_t>(opt.batch), opt.seed);
+    std::vector<int> actions(env.size());
+    std::vector<float> rewards(env.size());
+    std::vector<std::uint8_t> dones(env.size());
+    unsigned lcg = 1;
+
+    long long episodes = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for(int step=0; step<opt.steps; ++step){
+        for(auto& a: actions){
+            lcg = lcg*1664525u + 1013904223u;
+            a = static_cast<int>((lcg >> 8) % BatchGame::ACTIONS);
+        }
+        env.step(actions.data(), rewards.data(), dones.data());
+        for(auto d: dones) episodes += d;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+    double env_steps = double(opt.steps) * env.size();
+
+    std::printf("boards:       %zu\n", env.size());
+    std::printf("steps:        %d\n", opt.steps);
+    std::printf("episodes:     %lld\n", episodes);
+    std::printf("time:         %.3f s\n", secs);
+    std::printf("env steps/sec: %.0f\n", env_steps / secs);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+    Options opt = parse(argc, argv);
+    if(opt.batch > 0) return run_batch(opt);
+
+    // simulated clock: every piece costs one lock delay of game time
+    Game::clock::time_point sim{};
+    Game game;
+    game.set_time(sim);
+    game.init(opt.seed);
+
+    Ai ai(opt.depth < 2 ? 1 : opt.threads);
+    ai.depth = opt.depth;
+    ai.use_tt(opt.tt_mb);
+    if(opt.weights && !Ai::load_weights(opt.weights, ai.weights)){
+        std::fprintf(stderr, "cannot load weights from %s\n", opt.weights);
+        return 1;
+    }
+
+    long long pieces = 0, lines = 0, score = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for(int g=0; g<opt.games; ++g){
+        ReplayRecorder recorder;
+        if(opt.record_dir){
+            // each game gets its own seed so its replay stands alone
+            char path[512];
+            std::snprintf(path, sizeof(path), "%s/game-%05d.ttr", opt.record_dir, g);
+            game.set_time(sim);
+            game.init(opt.seed + static_cast<std::uint64_t>(g));
+            if(recorder.open(path, game.seed, sim)) game.recorder = &recorder;
+        }
+        game.set_time(sim);
+        game.reset();
+        for(int n=0; n<opt.max_pieces && !game.over; ++n){
+            Ai::apply(game, ai.choose(game));
+            game.check_and_lock();   // starts the lock timer
+            sim += Game::LOCK_DELAY;
+            game.set_time(sim);
+            game.tick();             // lock delay expired -> piece locks
+            game.update_flash();
+            ++pieces;
+        }
+        lines += game.total_lines_cleared;
+        score += game.score;
+        recorder.finish(game);
+        game.recorder = nullptr;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+
+    std::printf("games:        %d\n", opt.games);
+    std::printf("pieces:       %lld\n", pieces);
+    std::printf("lines:        %lld\n", lines);
+    std::printf("avg score:    %.1f\n", opt.games ? double(score) / opt.games : 0.0);
+    std::printf("time:         %.3f s\n", secs);
+    std::printf("pieces/sec:   %.0f\n", pieces / secs);
+    std::printf("games/sec:    %.1f\n", opt.games / secs);
+    std::printf("lines/sec:    %.0f\n", lines / secs);
+    std::printf("decisions/sec: %.0f\n", ai.decisions / secs);
+    std::printf("nodes/sec:    %.0f\n", ai.nodes / secs);
+    if(opt.tt_mb){
+        std::printf("tt size:      %.1f MiB\n", ai.tt_bytes() / (1024.0 * 1024.0));
+        std::printf("tt hit rate:  %.1f%% (%lld/%lld)\n",
+                    100.0 * ai.tt_hit_rate(), ai.tt_hits, ai.tt_probes);
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "draw_list.h"
+#include <algorithm>
+#include <cstring>
+
+unsigned long rgb(unsigned char r,unsigned char g,unsigned char b){
+    return (r<<16)|(g<<8)|b;
+}
+
+void DrawList::clear(){
+    for(std::size_t i=0;i<used;++i){
+        batches[i].rects.clear();
+        batches[i].segs.clear();
+    }
+    used = 0;
+    layer_start = 0;
+    texts.clear();
+    sent_bytes = 0;
+}
+
+void DrawList::layer(){
+    layer_start = used;
+}
+
+DrawList::Batch& DrawList::batch(Kind kind, Style style, unsigned long pixel){
+    for(std::size_t i=layer_start;i<used;++i){
+        Batch& b = batches[i];
+        if(b.kind == kind && b.style == style && b.pixel == pixel) return b;
+    }
+    if(used == batches.size()) batches.emplace_back();
+    Batch& b = batches[used++];
+    b.kind = kind;
+    b.style = style;
+    b.pixel = pixel;
+    return b;
+}
+
+void DrawList::fill(unsigned long pixel, int x,int y,int w,int h){
+    batch(Fill, Solid, pixel).rects.push_back(XRectangle{
+        static_cast<short>(x), static_cast<short>(y),
+        static_cast<unsigned short>(w), static_cast<unsigned short>(h)});
+}
+
+void DrawList::outline(unsigned long pixel, int x,int y,int w,int h, Style style){
+    batch(Outline, style, pixel).rects.push_back(XRectangle{
+        static_cast<short>(x), static_cast<short>(y),
+        static_cast<unsigned short>(w), static_cast<unsigned short>(h)});
+}
+
+void DrawList::line(unsigned long pixel, int x1,int y1,int x2,int y2){
+    batch(Segments, Solid, pixel).segs.push_back(XSegment{
+        static_cast<short>(x1), static_cast<short>(y1),
+        static_cast<short>(x2), static_cast<short>(y2)});
+}
+
+void DrawList::text(unsigned long pixel, int x,int y, const char* s){
+    Text t;
+    t.pixel = pixel;
+    t.x = x;
+    t.y = y;
+    t.len = static_cast<int>(std::min(std::strlen(s), sizeof(t.s)));
+    std::memcpy(t.s, s, t.len);
+    texts.push_back(t);
+}
+
+static bool touches(const std::vector<XRectangle>& area, int x,int y,int w,int h){
+    for(const XRectangle& a: area)
+        if(x < a.x + a.width && a.x < x + w && y < a.y + a.height && a.y < y + h)
+            return true;
+    return false;
+}
+
+void DrawList::restrict_to(const std::vector<XRectangle>& area, const TextMetrics& tm){
+    for(std::size_t i=0;i<used;++i){
+        Batch& b = batches[i];
+        // outlines cover one pixel more than their size, like the server draws them
+        int extra = b.kind == Outline ? 1 : 0;
+        b.rects.erase(std::remove_if(b.rects.begin(), b.rects.end(), [&](const XRectangle& r){
+            return !touches(area, r.x, r.y, r.width + extra, r.height + extra);
+        }), b.rects.end());
+        b.segs.erase(std::remove_if(b.segs.begin(), b.segs.end(), [&](const XSegment& s){
+            int x = std::min(s.x1, s.x2), y = std::min(s.y1, s.y2);
+            return !touches(area, x, y, std::max(s.x1, s.x2) - x + 1, std::max(s.y1, s.y2) - y + 1);
+        }), b.segs.end());
+    }
+    texts.erase(std::remove_if(texts.begin(), texts.end(), [&](const Text& t){
+        return !touches(area, t.x, t.y - tm.ascent, t.len * tm.advance, tm.ascent + tm.descent);
+    }), texts.end());
+}
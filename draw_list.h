@@ -0,0 +1,72 @@
+#pragma once
+
+#include <X11/Xlib.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+unsigned long rgb(unsigned char r,unsigned char g,unsigned char b);
+
+// on/off dash lengths of the ghost and line-clear flash outlines
+constexpr char GHOST_DASH = 4;
+constexpr char FLASH_DASH = 3;
+
+// Glyph box of a backend's font: how far text reaches above and below its
+// baseline and how far each character advances.
+struct TextMetrics { int ascent, descent, advance; };
+
+// Per-frame list of draw commands. Shapes are bucketed by kind, line
+// style and pixel, and each bucket goes out as one XFillRectangles /
+// XDrawRectangles / XDrawSegments request, so a frame costs one request and
+// at most one XSetForeground per color instead of one per cell. Layers keep
+// the painter's order where shapes overlap; text is always drawn last.
+// Buffers keep their capacity between frames.
+class DrawList {
+public:
+    // outline styles, each drawn with its own pre-configured GC
+    enum Style : std::uint8_t { Solid, Ghost, Flash };
+    enum Kind : std::uint8_t { Fill, Outline, Segments };
+
+    struct Batch {
+        Kind kind;
+        Style style;
+        unsigned long pixel;
+        std::vector<XRectangle> rects;
+        std::vector<XSegment> segs;
+    };
+    struct Text {
+        unsigned long pixel;
+        int x, y, len;
+        char s[48];
+    };
+
+    void clear();
+    void layer();    // later commands draw over everything before this
+
+    void fill(unsigned long pixel, int x,int y,int w,int h);
+    void outline(unsigned long pixel, int x,int y,int w,int h, Style style = Solid);
+    void line(unsigned long pixel, int x1,int y1,int x2,int y2);
+    void text(unsigned long pixel, int x,int y, const char* s);
+
+    // drop every shape and string that does not touch `area`; what is left
+    // repaints `area` completely when drawn clipped to it
+    void restrict_to(const std::vector<XRectangle>& area, const TextMetrics& tm);
+
+    void submit(Display* dpy, Drawable drw, GC solid, GC ghost, GC flash);
+    void submit_text(Display* dpy, Drawable drw, GC solid);
+
+    std::size_t sent_bytes = 0;   // protocol bytes submitted since clear()
+
+    // read access for software rasterizers, in painter's order
+    std::size_t size() const { return used; }
+    const Batch& operator[](std::size_t i) const { return batches[i]; }
+    const std::vector<Text>& text_items() const { return texts; }
+
+private:
+    Batch& batch(Kind kind, Style style, unsigned long pixel);
+
+    std::vector<Batch> batches;
+    std::size_t used = 0;         // batches in this frame
+    std::size_t layer_start = 0;  // first batch of the current layer
+    std::vector<Text> texts;
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// Built-in 5x7 bitmap font (printable ASCII, two extra rows for
+// descenders) so frames can carry text without a font server. Row 0 is
+// the top; bit 4 of a row is the leftmost pixel. A string drawn at
+// (x, y) has its baseline on row y, like XDrawString.
+constexpr int FONT_W = 5;
+constexpr int FONT_H = 9;
+constexpr int FONT_ASCENT = 7;
+constexpr int FONT_ADVANCE = 6;
+constexpr char FONT_FIRST = ' ';
+constexpr char FONT_LAST = '~';
+
+extern const std::uint8_t FONT[FONT_LAST - FONT_FIRST + 1][FONT_H];
@@ -0,0 +1,293 @@
+//
+// End-to-end frame benchmark for the X11 renderer. Starts a private Xvfb
+// (or uses --display NAME), opens the real game window and renders scripted
+// frames for a set of board states with both backends, measuring per frame
+// the CPU time of RenderContext::render, the X requests it issued and their
+// size in bytes, the XSync round trip until the server has executed them,
+// and the achieved frame rate, once with incremental (damage-only) redraw
+// and once repainting every frame in full. Percentiles go to stdout (or
+// --out FILE) as JSON.
+//
+#include "game.h"
+#include "render.h"
+#include <X11/Xlib.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+struct Scenario {
+    const char* name;
+    Game game;
+};
+
+struct Stats {
+    double p50, p90, p99, max;
+};
+
+struct Result {
+    const char* backend;
+    const char* scenario;
+    bool ghost;
+    bool incremental;
+    int frames;
+    double fps;
+    Stats render_cpu_us, requests, bytes, sync_us;
+};
+
+// tiny LCG so boards are identical on every run
+struct Lcg {
+    unsigned state;
+    unsigned next(){ state = state*1664525u + 1013904223u; return state >> 8; }
+};
+
+void set_cell(Game& g, int r, int c, int id){
+    g.field[r] |= Row(1) << (c + Game::WALL);
+    g.cells[r][c] = static_cast<std::uint8_t>(id + 1);
+}
+
+void fill_rows(Game& g, int from, Lcg& lcg){
+    for(int r=from;r<Game::H;++r){
+        int gap1 = lcg.next() % Game::W;
+        int gap2 = lcg.next() % Game::W;
+        for(int c=0;c<Game::W;++c)
+            if(c != gap1 && c != gap2) set_cell(g, r, c, (r+c) % Game::PIECE_COUNT);
+    }
+}
+
+std::vector<Scenario> make_scenarios(){
+    std::vector<Scenario> out;
+    Game base;
+    base.set_time(Game::clock::time_point{});
+    base.init(1);
+    out.push_back({"empty", base});
+
+    Lcg lcg{12345};
+    Scenario dense{"dense", base};
+    fill_rows(dense.game, 6, lcg);
+    out.push_back(dense);
+
+    // four full rows just cleared and flashing over a half-filled board
+    Scenario flash{"flash_multi_clear", base};
+    fill_rows(flash.game, Game::H/2, lcg);
+    for(int r=Game::H-4;r<Game::H;++r){
+        Game::ClearedRow cr{};
+        cr.row = r;
+        for(int c=0;c<Game::W;++c) cr.data[c] = static_cast<std::uint8_t>((r+c) % Game::PIECE_COUNT + 1);
+        flash.game.cleared_rows.push_back(cr);
+    }
+    flash.game.flashing = true;
+    out.push_back(flash);
+    for(Scenario& sc: out) sc.game.rebuild_skyline();
+    return out;
+}
+
+// scripted input: the active piece wanders and falls so every frame differs
+void script_step(Game& g, int frame){
+    static const int moves[8][3] = {
+        {-1,0,0}, {-1,0,0}, {0,0,1}, {0,1,0}, {1,0,0}, {1,0,0}, {0,0,1}, {0,1,0},
+    };
+    const int* m = moves[frame % 8];
+    if(m[1] && g.collides(g.px, g.py + 1, g.pr)){
+        g.py = 0;   // reached the stack: start over at the top
+        g.px = Game::SPAWN_X;
+    } else {
+        g.try_move(m[0], m[1], m[2]);
+    }
+    // flash phase alternates every 80 ms of game time
+    g.set_time(Game::clock::time_point{} + std::chrono::milliseconds(frame * 40));
+    g.flash_until = g.now + Game::FLASH_TIME;
+}
+
+Stats percentiles(std::vector<double> v){
+    std::sort(v.begin(), v.end());
+    auto at = [&](double q){ return v[std::min(v.size()-1, static_cast<size_t>(q * v.size()))]; };
+    return {at(0.50), at(0.90), at(0.99), v.back()};
+}
+
+double thread_cpu_us(){
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+Result run(Display* dpy, const Scenario& sc, bool ghost, bool software, bool incremental,
+           int frames){
+    int screen = DefaultScreen(dpy);
+    Layout layout = Layout::standard();
+    Window win = XCreateSimpleWindow(dpy, RootWindow(dpy, screen), 0, 0,
+                                     layout.width, layout.height, 0,
+                                     BlackPixel(dpy, screen), WhitePixel(dpy, screen));
+    XSelectInput(dpy, win, ExposureMask | StructureNotifyMask);
+    XMapWindow(dpy, win);
+    XEvent e;
+    do XNextEvent(dpy, &e); while(e.type != MapNotify);
+
+    RenderContext ctx;
+    ctx.init(dpy, win, layout.width, layout.height, sc.game, software);
+    ctx.incremental = incremental;
+    Game g = sc.game;
+    g.show_ghost = ghost;
+
+    std::vector<double> cpu, requests, bytes, sync;
+    cpu.reserve(frames);
+    requests.reserve(frames);
+    bytes.reserve(frames);
+    sync.reserve(frames);
+    auto t0 = bench_clock::now();
+    for(int f=0; f<frames; ++f){
+        script_step(g, f);
+        double c0 = thread_cpu_us();
+        ctx.render(g);
+        double c1 = thread_cpu_us();
+        auto s0 = bench_clock::now();
+        XSync(dpy, False);
+        auto s1 = bench_clock::now();
+        while(XPending(dpy)){
+            XNextEvent(dpy, &e);
+            ctx.event(e);
+        }
+        cpu.push_back(c1 - c0);
+        requests.push_back(static_cast<double>(ctx.frame_requests));
+        bytes.push_back(static_cast<double>(ctx.frame_bytes));
+        sync.push_back(std::chrono::duration<double, std::micro>(s1 - s0).count());
+    }
+    double secs = std::chrono::duration<double>(bench_clock::now() - t0).count();
+
+    Result r{ctx.software ? (ctx.shm ? "shm" : "putimage") : "xlib",
+             sc.name, ghost, incremental, frames, frames / secs,
+             percentiles(cpu), percentiles(requests), percentiles(bytes), percentiles(sync)};
+    ctx.release();
+    XDestroyWindow(dpy, win);
+    XSync(dpy, False);
+    return r;
+}
+
+// Xvfb picks a free display itself and writes its number to -displayfd
+// once it accepts connections; name is left empty if it never does.
+pid_t start_xvfb(std::string& name){
+    int fds[2];
+    if(pipe(fds) < 0) return -1;
+    pid_t pid = fork();
+    if(pid == 0){
+        close(fds[0]);
+        std::string fd = std::to_string(fds[1]);
+        execlp("Xvfb", "Xvfb", "-displayfd", fd.c_str(), "-screen", "0", "1024x768x24",
+               "-nolisten", "tcp", static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(fds[1]);
+    if(pid > 0){
+        char buf[16];
+        std::size_t len = 0;
+        ssize_t got;
+        while(len < sizeof(buf) && (got = read(fds[0], buf + len, sizeof(buf) - len)) != 0){
+            if(got < 0){
+                if(errno == EINTR) continue;
+                break;
+            }
+            len += static_cast<std::size_t>(got);
+            if(std::memchr(buf, '\n', len)) break;
+        }
+        int number = 0;
+        std::size_t digits = 0;
+        for(; digits < len && buf[digits] >= '0' && buf[digits] <= '9'; ++digits)
+            number = number*10 + (buf[digits] - '0');
+        if(digits) name = ":" + std::to_string(number);
+    }
+    close(fds[0]);
+    return pid;
+}
+
+void write_stats(std::FILE* fp, const char* key, const Stats& s, const char* tail){
+    std::fprintf(fp, "\"%s\": {\"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f}%s",
+                 key, s.p50, s.p90, s.p99, s.max, tail);
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+    const char* out_path = nullptr;
+    const char* display = nullptr;
+    int frames = 600;
+    for(int i=1;i<argc;++i){
+        if(!std::strcmp(argv[i], "--out") && i+1 < argc) out_path = argv[++i];
+        else if(!std::strcmp(argv[i], "--display") && i+1 < argc) display = argv[++i];
+        else if(!std::strcmp(argv[i], "--frames") && i+1 < argc) frames = std::atoi(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--display NAME] [--frames N] [--out FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if(frames < 1) frames = 1;
+
+    pid_t xvfb = -1;
+    std::string name;
+    if(display){
+        name = display;
+    } else {
+        xvfb = start_xvfb(name);
+        if(xvfb < 0){
+            std::perror("fork");
+            return 1;
+        }
+        if(name.empty()){
+            std::fprintf(stderr, "Xvfb exited (is it installed?)\n");
+            waitpid(xvfb, nullptr, 0);
+            return 1;
+        }
+    }
+
+    Display* dpy = XOpenDisplay(name.c_str());
+    if(!dpy){
+        std::fprintf(stderr, "cannot open display %s\n", name.c_str());
+        if(xvfb > 0) kill(xvfb, SIGTERM);
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for(const Scenario& sc: make_scenarios())
+        for(bool ghost: {true, false})
+            for(bool software: {false, true})
+                for(bool incremental: {true, false})
+                    results.push_back(run(dpy, sc, ghost, software, incremental, frames));
+    XCloseDisplay(dpy);
+    if(xvfb > 0){
+        kill(xvfb, SIGTERM);
+        waitpid(xvfb, nullptr, 0);
+    }
+
+    std::FILE* fp = out_path ? std::fopen(out_path, "w") : stdout;
+    if(!fp){
+        std::perror(out_path);
+        return 1;
+    }
+    std::fprintf(fp, "{\n  \"display\": \"%s\",\n  \"frames\": %d,\n  \"results\": [\n", name.c_str(), frames);
+    for(size_t i=0;i<results.size();++i){
+        const Result& r = results[i];
+        std::fprintf(fp, "    {\"backend\": \"%s\", \"scenario\": \"%s\", \"ghost\": %s, "
+                         "\"incremental\": %s, \"fps\": %.1f, ",
+                     r.backend, r.scenario, r.ghost ? "true" : "false",
+                     r.incremental ? "true" : "false", r.fps);
+        write_stats(fp, "render_cpu_us", r.render_cpu_us, ", ");
+        write_stats(fp, "requests", r.requests, ", ");
+        write_stats(fp, "bytes", r.bytes, ", ");
+        write_stats(fp, "sync_us", r.sync_us, "");
+        std::fprintf(fp, "}%s\n", i+1 < results.size() ? "," : "");
+    }
+    std::fprintf(fp, "  ]\n}\n");
+    if(fp != stdout) std::fclose(fp);
+    return 0;
+}
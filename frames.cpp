@@ -0,0 +1,94 @@
+//
+// Headless frame dumper: renders a recorded session (--replay, at --fps
+// frames per second of game time) or a bot game (--seed, one frame per
+// piece) with the offscreen renderer and streams the frames as PPM, or
+// bare RGB24 with --raw, to --out (a file, a FIFO or - for stdout). No X
+// server is involved.
+//
+#include "ai.h"
+#include "game.h"
+#include "offscreen.h"
+#include "replay.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char** argv){
+    const char* replay = nullptr;
+    const char* out = nullptr;
+    std::uint64_t seed = 1;
+    int pieces = 500;
+    int fps = 30;
+    auto format = OffscreenRenderer::Format::Ppm;
+    for(int i=1;i<argc;++i){
+        if(!std::strcmp(argv[i], "--replay") && i+1 < argc) replay = argv[++i];
+        else if(!std::strcmp(argv[i], "--out") && i+1 < argc) out = argv[++i];
+        else if(!std::strcmp(argv[i], "--seed") && i+1 < argc) seed = std::strtoull(argv[++i], nullptr, 0);
+        else if(!std::strcmp(argv[i], "--pieces") && i+1 < argc) pieces = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--fps") && i+1 < argc) fps = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--raw")) format = OffscreenRenderer::Format::Raw;
+        else {
+            std::fprintf(stderr,
+                "usage: %s [--replay FILE [--fps N] | --seed N [--pieces N]] [--out FILE|-] [--raw]\n",
+                argv[0]);
+            return 2;
+        }
+    }
+    if(fps <= 0) fps = 30;
+
+    Game game;
+    game.set_time(Game::clock::time_point{});
+    game.init(seed);
+    OffscreenRenderer renderer(game);
+    if(out && !renderer.open(out, format)){
+        std::fprintf(stderr, "cannot open %s\n", out);
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    double game_seconds = 0;
+    if(replay){
+        // frames at fixed steps of game time, each showing the state before
+        // the first record at or after it
+        auto frame_step = std::chrono::duration_cast<Game::clock::duration>(
+            std::chrono::duration<double>(1.0 / fps));
+        Game::clock::time_point next_frame{};
+        Game view;
+        ReplayResult res = verify_replay_file(replay, [&](const Game& g, Game::clock::time_point t){
+            while(next_frame < t){
+                view = g;
+                view.set_time(next_frame);
+                renderer.render(view);
+                next_frame += frame_step;
+            }
+        });
+        if(!res.ok){
+            std::fprintf(stderr, "%s: %s\n", replay, res.error.c_str());
+            return 1;
+        }
+        game_seconds = res.game_seconds;
+    } else {
+        Ai ai(1);
+        Game::clock::time_point sim{};
+        for(int n=0; n<pieces && !game.over; ++n){
+            Ai::apply(game, ai.choose(game));
+            renderer.render(game);
+            game.check_and_lock();
+            sim += Game::LOCK_DELAY;
+            game.set_time(sim);
+            game.tick();
+            game.update_flash();
+        }
+        game_seconds = std::chrono::duration<double>(sim.time_since_epoch()).count();
+    }
+    renderer.close();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    const Raster& f = renderer.frame();
+    std::fprintf(stderr, "%lld frames of %dx%d in %.3f s (%.0f frames/sec, %.0fx real time)\n",
+                 renderer.frames, f.width, f.height, secs,
+                 secs > 0 ? renderer.frames / secs : 0.0,
+                 secs > 0 ? game_seconds / secs : 0.0);
+    return 0;
+}
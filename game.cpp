@@ -2,62 +2,125 @@
 // Created by roman on 2025-11-22.
 //
 #include "game.h"
+#include "replay.h"
+#include "trace.h"
 #include <algorithm>
+#include <initializer_list>
 #include <random>
 
 namespace {
 
-const std::array<std::array<Shape,4>,Game::PIECE_COUNT> SHAPES = {{
+constexpr Shape make_shape(std::initializer_list<Vec> cells){
+    Shape s{};
+    s.minx = s.miny = 3;
+    s.maxx = s.maxy = 0;
+    for(auto& b: s.bottom) b = -1;
+    for(auto v: cells){
+        s.cells[s.count++] = v;
+        s.rows[v.y] |= Row(1) << v.x;
+        if(v.x < s.minx) s.minx = v.x;
+        if(v.x > s.maxx) s.maxx = v.x;
+        if(v.y < s.miny) s.miny = v.y;
+        if(v.y > s.maxy) s.maxy = v.y;
+        if(v.y > s.bottom[v.x]) s.bottom[v.x] = v.y;
+    }
+    // preview box is 4x4 tiles; offsets are in half tiles so they stay exact
+    s.preview_x2 = (4 - (s.maxx - s.minx + 1)) - 2*s.minx;
+    s.preview_y2 = (4 - (s.maxy - s.miny + 1)) - 2*s.miny;
+    return s;
+}
+
+constexpr std::array<std::array<Shape,4>,Game::PIECE_COUNT> SHAPES = {{
     {{ // I
-        {{ {0,1},{1,1},{2,1},{3,1} }},
-        {{ {2,0},{2,1},{2,2},{2,3} }},
-        {{ {0,2},{1,2},{2,2},{3,2} }},
-        {{ {1,0},{1,1},{1,2},{1,3} }}
+        make_shape({ {0,1},{1,1},{2,1},{3,1} }),
+        make_shape({ {2,0},{2,1},{2,2},{2,3} }),
+        make_shape({ {0,2},{1,2},{2,2},{3,2} }),
+        make_shape({ {1,0},{1,1},{1,2},{1,3} })
     }},
     {{ // J
-        {{ {0,0},{0,1},{1,1},{2,1} }},
-        {{ {1,0},{2,0},{1,1},{1,2} }},
-        {{ {0,1},{1,1},{2,1},{2,2} }},
-        {{ {1,0},{1,1},{0,2},{1,2} }}
+        make_shape({ {0,0},{0,1},{1,1},{2,1} }),
+        make_shape({ {1,0},{2,0},{1,1},{1,2} }),
+        make_shape({ {0,1},{1,1},{2,1},{2,2} }),
+        make_shape({ {1,0},{1,1},{0,2},{1,2} })
     }},
     {{ // L
-        {{ {2,0},{0,1},{1,1},{2,1} }},
-        {{ {1,0},{1,1},{1,2},{2,2} }},
-        {{ {0,1},{1,1},{2,1},{0,2} }},
-        {{ {0,0},{1,0},{1,1},{1,2} }}
+        make_shape({ {2,0},{0,1},{1,1},{2,1} }),
+        make_shape({ {1,0},{1,1},{1,2},{2,2} }),
+        make_shape({ {0,1},{1,1},{2,1},{0,2} }),
+        make_shape({ {0,0},{1,0},{1,1},{1,2} })
     }},
     {{ // O
-        {{ {1,0},{2,0},{1,1},{2,1} }},
-        {{ {1,0},{2,0},{1,1},{2,1} }},
-        {{ {1,0},{2,0},{1,1},{2,1} }},
-        {{ {1,0},{2,0},{1,1},{2,1} }}
+        make_shape({ {1,0},{2,0},{1,1},{2,1} }),
+        make_shape({ {1,0},{2,0},{1,1},{2,1} }),
+        make_shape({ {1,0},{2,0},{1,1},{2,1} }),
+        make_shape({ {1,0},{2,0},{1,1},{2,1} })
     }},
     {{ // S
-        {{ {1,0},{2,0},{0,1},{1,1} }},
-        {{ {1,0},{1,1},{2,1},{2,2} }},
-        {{ {1,1},{2,1},{0,2},{1,2} }},
-        {{ {0,0},{0,1},{1,1},{1,2} }}
+        make_shape({ {1,0},{2,0},{0,1},{1,1} }),
+        make_shape({ {1,0},{1,1},{2,1},{2,2} }),
+        make_shape({ {1,1},{2,1},{0,2},{1,2} }),
+        make_shape({ {0,0},{0,1},{1,1},{1,2} })
     }},
     {{ // T
-        {{ {1,0},{0,1},{1,1},{2,1} }},
-        {{ {1,0},{1,1},{2,1},{1,2} }},
-        {{ {0,1},{1,1},{2,1},{1,2} }},
-        {{ {1,0},{0,1},{1,1},{1,2} }}
+        make_shape({ {1,0},{0,1},{1,1},{2,1} }),
+        make_shape({ {1,0},{1,1},{2,1},{1,2} }),
+        make_shape({ {0,1},{1,1},{2,1},{1,2} }),
+        make_shape({ {1,0},{0,1},{1,1},{1,2} })
     }},
     {{ // Z
-        {{ {0,0},{1,0},{1,1},{2,1} }},
-        {{ {2,0},{1,1},{2,1},{1,2} }},
-        {{ {0,1},{1,1},{1,2},{2,2} }},
-        {{ {1,0},{0,1},{1,1},{0,2} }}
+        make_shape({ {0,0},{1,0},{1,1},{2,1} }),
+        make_shape({ {2,0},{1,1},{2,1},{1,2} }),
+        make_shape({ {0,1},{1,1},{1,2},{2,2} }),
+        make_shape({ {1,0},{0,1},{1,1},{0,2} })
     }},
     {{ // Dot
-        {{ {0,0} }},
-        {{ {0,0} }},
-        {{ {0,0} }},
-        {{ {0,0} }}
+        make_shape({ {0,0} }),
+        make_shape({ {0,0} }),
+        make_shape({ {0,0} }),
+        make_shape({ {0,0} })
     }}
 }};
 
+// splitmix64, used at compile time to fill the Zobrist tables
+constexpr std::uint64_t splitmix64(std::uint64_t& state){
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// A row hashes as a few table lookups instead of one key per set bit: for
+// every row and 5-column chunk, the XOR of the cell keys of all 32 patterns.
+// This keeps clear_lines on the multi_line_clear microbench fixture within
+// about 2x of the unhashed compaction (~1 us with the per-bit scan).
+constexpr int CHUNK_BITS = 5;
+constexpr int CHUNKS = (Game::W + CHUNK_BITS - 1) / CHUNK_BITS;
+
+struct ZobristKeys {
+    std::uint64_t cell[Game::H][Game::W]{};
+    std::uint64_t row[Game::H][CHUNKS][1 << CHUNK_BITS]{};
+    std::uint64_t piece[Game::PIECE_COUNT][Game::PIECE_COUNT]{}; // [queue slot][piece id]
+    std::uint64_t bag[Game::PIECE_COUNT + 1]{};
+};
+
+constexpr ZobristKeys make_zobrist_keys(){
+    ZobristKeys k{};
+    std::uint64_t state = 0x7e7215ull;
+    for(auto& row: k.cell)
+        for(auto& key: row) key = splitmix64(state);
+    for(auto& slot: k.piece)
+        for(auto& key: slot) key = splitmix64(state);
+    for(auto& key: k.bag) key = splitmix64(state);
+    for(int r=0;r<Game::H;++r)
+        for(int c=0;c<CHUNKS;++c)
+            for(int m=0;m<(1 << CHUNK_BITS);++m)
+                for(int b=0;b<CHUNK_BITS && c*CHUNK_BITS + b < Game::W;++b)
+                    if(m & (1 << b)) k.row[r][c][m] ^= k.cell[r][c*CHUNK_BITS + b];
+    return k;
+}
+
+constexpr ZobristKeys ZOBRIST = make_zobrist_keys();
+
 std::chrono::milliseconds compute_drop_interval(int level) {
     int base = 500;   // ms
     int step = 40;    // decrease per level
@@ -71,7 +134,12 @@ std::chrono::milliseconds compute_drop_interval(int level) {
 
 void Game::init(){
     std::random_device rd;
-    rng.seed(rd());
+    init((std::uint64_t(rd()) << 32) | rd());
+}
+
+void Game::init(std::uint64_t s){
+    seed = s;
+    rng.seed(s);
 
     // default piece colors (can be overridden later if needed)
     colors[0] = 0x00ffff;
@@ -93,14 +161,22 @@ void Game::init(){
 }
 
 void Game::reset(){
-    field = {};
+    if(recorder) recorder->add(ReplayEvent::Restart, now);
+    field.fill(EMPTY_ROW);
+    cells = {};
+    column_top.fill(H);
+    ++board_epoch;
+    board_hash = 0;
     over = false;
     paused = false;
-    px = 3; py = 0; pr = 0;
+    px = SPAWN_X; py = 0; pr = 0;
+    lock_timer_active = false;
+    last_drop = now;
 
     score = 0;
     level = 1;
     total_lines_cleared = 0;
+    pieces_placed = 0;
 
     bag_pos = 0;
     refill_bag();
@@ -115,74 +191,197 @@ void Game::update_drop_interval(){
 }
 
 void Game::refill_bag() {
-    bag.resize(PIECE_COUNT);
     for(int i=0;i<PIECE_COUNT;++i) bag[i] = i;
-    std::shuffle(bag.begin(), bag.end(), rng);
+    rng.shuffle(bag.begin(), bag.end());
     bag_pos = 0;
 }
 
 int Game::next_piece() {
-    if(bag.empty() || bag_pos >= bag.size()){
+    if(bag_pos >= bag.size()){
         refill_bag();
     }
     return bag[bag_pos++];
 }
 
-bool Game::collides(int nx,int ny,int nr) const{
-    for(auto v: pieces[cur].rot[nr]){
-        int gx = nx + v.x;
-        int gy = ny + v.y;
-        if(gx < 0 || gx >= W || gy < 0 || gy >= H) return true;
-        if(field[gy][gx]) return true;
+int Game::line_score(int lines,int level){
+    static const int base_scores[5] = {0,100,300,700,1200}; // tuned rewards per line count
+    int capped = std::min(lines, 4);
+    return base_scores[capped] * level;
+}
+
+int Game::level_for_lines(int total_lines){
+    return 1 + total_lines / 10; // level up every 10 lines
+}
+
+const Shape& Game::shape(int id,int rot){
+    return SHAPES[id][rot];
+}
+
+bool Game::collides(const Field& f,const Shape& s,int nx,int ny){
+    // piece cells are at local x 0..3, so anything left of -WALL or right of
+    // the top wall bit is out of the board for every cell
+    int shift = nx + WALL;
+    if(shift < 0 || shift > 32 - 4) return true;
+    for(int i=0;i<4;++i){
+        if(!s.rows[i]) continue;
+        int gy = ny + i;
+        if(gy < 0 || gy >= H) return true;
+        if(f[gy] & (s.rows[i] << shift)) return true;
     }
     return false;
 }
 
+std::uint64_t Game::row_hash(int r,Row bits){
+    std::uint64_t h = 0;
+    bits = (bits & BOARD_BITS) >> WALL;
+    for(int c=0;c<CHUNKS;++c)
+        h ^= ZOBRIST.row[r][c][(bits >> (c*CHUNK_BITS)) & ((1u << CHUNK_BITS) - 1)];
+    return h;
+}
+
+std::uint64_t Game::row_move_hash(int from,int to,Row bits){
+    std::uint64_t h = 0;
+    bits = (bits & BOARD_BITS) >> WALL;
+    for(int c=0;c<CHUNKS;++c){
+        unsigned m = (bits >> (c*CHUNK_BITS)) & ((1u << CHUNK_BITS) - 1);
+        h ^= ZOBRIST.row[from][c][m] ^ ZOBRIST.row[to][c][m];
+    }
+    return h;
+}
+
+std::uint64_t Game::hash_field(const Field& f){
+    std::uint64_t h = 0;
+    for(int r=0;r<H;++r) h ^= row_hash(r, f[r]);
+    return h;
+}
+
+std::uint64_t Game::piece_key(int slot,int id){
+    return ZOBRIST.piece[slot][id];
+}
+
+std::uint64_t Game::hash() const{
+    return board_hash ^ ZOBRIST.piece[0][cur] ^ ZOBRIST.piece[1][nxt] ^ ZOBRIST.bag[bag_pos];
+}
+
+void Game::skyline(const Field& f,Skyline& top){
+    // walk rows top-down; the first row that has a column is its top
+    top.fill(H);
+    Row seen = 0;
+    for(int r=0;r<H && seen != BOARD_BITS;++r){
+        Row tops = f[r] & BOARD_BITS & ~seen;
+        seen |= tops;
+        for(; tops; tops &= tops - 1)
+            top[__builtin_ctz(tops) - WALL] = r;
+    }
+}
+
+int Game::landing_row(const Skyline& top,const Shape& s,int nx,int ny){
+    int land = H;
+    for(int i=0;i<4;++i){
+        if(s.bottom[i] < 0) continue;
+        int c = nx + i;
+        if(c < 0 || c >= W) return -1;
+        land = std::min(land, top[c] - 1 - s.bottom[i]);
+    }
+    return land >= ny ? land : -1;
+}
+
+void Game::rebuild_skyline(){
+    skyline(field, column_top);
+    ++board_epoch;
+}
+
+int Game::drop_row() const{
+    std::uint64_t key = std::uint64_t(board_epoch) << 32 |
+        std::uint32_t((px + 16) << 16 | (py + 16) << 8 | pr << 4 | cur);
+    if(key == drop_key) return drop_y;
+    int y = landing_row(column_top, pieces[cur].rot[pr], px, py);
+    if(y < 0){
+        y = py;
+        while(!collides(px, y+1, pr))
+            ++y;
+    }
+    drop_key = key;
+    drop_y = y;
+    return y;
+}
+
+bool Game::collides(int nx,int ny,int nr) const{
+    TRACE_SCOPE("collides");
+    return collides(field, pieces[cur].rot[nr], nx, ny);
+}
+
 int Game::clear_lines(){
+    TRACE_SCOPE("clear_lines");
     cleared_rows.clear();
 
-    std::vector<int> full_rows;
+    // compact surviving rows towards the bottom in a single pass
+    // (the hash is accumulated in a local: the byte-sized cell stores below
+    // would otherwise force a reload of board_hash for every row)
+    std::uint64_t h = board_hash;
+    int dest = H-1;
     for(int r = H-1; r >= 0; --r){
-        bool full = true;
-        for(int c = 0; c < W; ++c){
-            if(!field[r][c]){ full = false; break; }
+        if(field[r] == FULL_ROW){
+            cleared_rows.push_back(ClearedRow{r, cells[r]});
+            h ^= row_hash(r, field[r]);
+            continue;
         }
-        if(full){
-            full_rows.push_back(r);
-            cleared_rows.push_back(ClearedRow{r, field[r]});
+        if(dest != r){
+            // every moved row leaves its old slot and lands in its new one;
+            // the empty rows above the stack hash to 0 either way
+            if(field[r] != EMPTY_ROW) h ^= row_move_hash(r, dest, field[r]);
+            field[dest] = field[r];
+            cells[dest] = cells[r];
         }
+        --dest;
+    }
+    board_hash = h;
+    for(int r = dest; r >= 0; --r){
+        field[r] = EMPTY_ROW;
+        cells[r] = {};
     }
-    if(full_rows.empty()) return 0;
 
-    Field new_field{};
-    int dest = H-1;
-    for(int r = H-1; r >= 0; --r){
-        if(std::find(full_rows.begin(), full_rows.end(), r) != full_rows.end())
-            continue;
-        new_field[dest--] = field[r];
+    // every cleared row was full, so each column lost cells at or below its
+    // top: rows above top+lines are empty now, its new top is at or below
+    int lines = dest + 1;
+    if(lines){
+        for(int c=0;c<W;++c){
+            Row bit = Row(1) << (c + WALL);
+            int r = std::min(column_top[c] + lines, H);
+            while(r < H && !(field[r] & bit)) ++r;
+            column_top[c] = r;
+        }
+        ++board_epoch;
     }
-    field = new_field;
-    return static_cast<int>(full_rows.size());
+    return lines;
 }
 
 void Game::lock_piece(){
+    TRACE_SCOPE("lock_piece");
+    if(recorder) recorder->add(ReplayEvent::Lock, now);
     for(auto v: pieces[cur].rot[pr]){
         int gx = px + v.x;
         int gy = py + v.y;
-        if(gy >= 0 && gy < H && gx >= 0 && gx < W)
-            field[gy][gx] = cur + 1;
+        if(gy >= 0 && gy < H && gx >= 0 && gx < W){
+            Row bit = Row(1) << (gx + WALL);
+            if(!(field[gy] & bit)) board_hash ^= ZOBRIST.cell[gy][gx];
+            field[gy] |= bit;
+            cells[gy][gx] = static_cast<std::uint8_t>(cur + 1);
+            column_top[gx] = std::min(column_top[gx], gy);
+        }
     }
+    ++board_epoch;
+
+    ++pieces_placed;
 
     int lines = clear_lines();
     if(lines > 0){
-        static const int base_scores[5] = {0,100,300,700,1200}; // tuned rewards per line count
-        int capped = std::min(lines, 4);
-        score += base_scores[capped] * level;
+        score += line_score(lines, level);
         total_lines_cleared += lines;
         flashing = true;
-        flash_until = std::chrono::steady_clock::now() + std::chrono::milliseconds(240);
+        flash_until = now + FLASH_TIME;
 
-        int new_level = 1 + total_lines_cleared / 10;
+        int new_level = level_for_lines(total_lines_cleared);
         if(new_level != level){
             level = new_level;
             update_drop_interval();
@@ -193,7 +392,7 @@ void Game::lock_piece(){
         cleared_rows.clear();
     }
 
-    px = 3; py = 0; pr = 0;
+    px = SPAWN_X; py = 0; pr = 0;
     cur = nxt;
     nxt = next_piece();
     if(collides(px,py,pr)){
@@ -205,13 +404,100 @@ void Game::lock_piece(){
 void Game::try_move(int dx,int dy,int dr){
     int nr = (pr + dr + 4) % 4;
     if(!collides(px+dx, py+dy, nr)){
+        if(recorder) record_move(dx, dy, dr);
         px += dx;
         py += dy;
         pr = nr;
     }
 }
 
+int Game::shift(int dir,int max_steps){
+    // one sweep over the columns ahead, then a single position update
+    const Shape& s = pieces[cur].rot[pr];
+    int n = 0;
+    while(n < max_steps && !collides(field, s, px + (n+1)*dir, py))
+        ++n;
+    if(recorder)
+        for(int i=0;i<n;++i)
+            recorder->add(dir < 0 ? ReplayEvent::Left : ReplayEvent::Right, now);
+    px += n*dir;
+    return n;
+}
+
 void Game::hard_drop(){
-    while(!collides(px,py+1,pr))
+    if(recorder) recorder->add(ReplayEvent::HardDrop, now);
+    py = drop_row();
+}
+
+bool Game::check_and_lock(){
+    bool touching = collides(px, py+1, pr);
+    if(!touching){
+        lock_timer_active = false;
+        return false;
+    }
+    if(!lock_timer_active){
+        lock_timer_active = true;
+        lock_start = now;
+        return false;
+    }
+    if(now - lock_start >= LOCK_DELAY){
+        lock_piece();
+        lock_timer_active = false;
+        last_drop = now;
+        return true;
+    }
+    return false;
+}
+
+void Game::soft_drop(){
+    if(!collides(px, py+1, pr)){
+        if(recorder) recorder->add(ReplayEvent::Down, now);
         py++;
+        last_drop = now;
+    } else {
+        check_and_lock();
+    }
+}
+
+bool Game::update_flash(){
+    if(flashing && now >= flash_until){
+        flashing = false;
+        cleared_rows.clear();
+        return true;
+    }
+    return false;
+}
+
+bool Game::tick(){
+    // if piece is resting, allow a short lock delay to nudge sideways/rotate
+    if(check_and_lock()) return true;
+
+    if(over || paused || now - last_drop < drop_ms) return false;
+    if(!collides(px, py+1, pr)){
+        if(recorder) recorder->add(ReplayEvent::Down, now);
+        py++;
+    } else
+        check_and_lock();
+    last_drop = now;
+    return true;
+}
+
+Game::clock::time_point Game::next_deadline() const{
+    clock::time_point t = clock::time_point::max();
+    if(flashing) t = std::min(t, flash_until);
+    if(over) return t;
+    // tick() checks the lock delay even while paused
+    if(lock_timer_active) t = std::min(t, lock_start + LOCK_DELAY);
+    else if(collides(px, py+1, pr)) t = std::min(t, now);   // tick() starts the timer
+    if(!paused) t = std::min(t, last_drop + drop_ms);
+    return t;
+}
+
+void Game::record_move(int dx,int dy,int dr){
+    dr = (dr % 4 + 4) % 4;
+    if(dx == -1 && dy == 0 && dr == 0) recorder->add(ReplayEvent::Left, now);
+    else if(dx == 1 && dy == 0 && dr == 0) recorder->add(ReplayEvent::Right, now);
+    else if(dx == 0 && dy == 1 && dr == 0) recorder->add(ReplayEvent::Down, now);
+    else if(dx == 0 && dy == 0 && dr == 1) recorder->add(ReplayEvent::Rotate, now);
+    else recorder->add(ReplayEvent::Move, now, (dx + 2) | ((dy + 2) << 2) | (dr << 4));
 }
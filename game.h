@@ -1,12 +1,32 @@
 #pragma once
 
 #include <array>
-#include <vector>
+#include <cstdint>
 #include <chrono>
-#include <random>
+#include "rng.h"
+
+class ReplayRecorder;
 
 struct Vec { int x, y; };
-using Shape = std::vector<Vec>;
+
+// one board row as a bitmask: bit (x + Game::WALL) is set when column x is occupied
+using Row = std::uint32_t;
+
+// one rotation of a piece; everything derived from the cells is filled in at
+// compile time (see make_shape in game.cpp)
+struct Shape {
+    static constexpr int MAX_CELLS = 4;
+
+    std::array<Vec,MAX_CELLS> cells{};
+    int count = 0;
+    std::array<Row,4> rows{};           // row masks, bit x = cell at local column x
+    int minx = 0, maxx = 0, miny = 0, maxy = 0; // bounding box
+    std::array<int,4> bottom{};         // lowest local y per local column, -1 if empty
+    int preview_x2 = 0, preview_y2 = 0; // half-tile offset centering rotation in a 4x4 box
+
+    constexpr const Vec* begin() const { return cells.data(); }
+    constexpr const Vec* end() const { return cells.data() + count; }
+};
 
 struct Piece {
     std::array<Shape,4> rot;
@@ -17,11 +37,24 @@ struct Game {
     static constexpr int W = 12;
     static constexpr int H = 24;
     static constexpr int PIECE_COUNT = 8;
+    static constexpr int SPAWN_X = 3;
 
-    using Field = std::array<std::array<int,W>,H>;
+    // occupancy bitboard: columns live at bits WALL..WALL+W-1, every other bit
+    // is a wall, so an empty row already collides with anything outside the board
+    static constexpr int WALL = 4;
+    static constexpr Row BOARD_BITS = ((Row(1) << W) - 1) << WALL;
+    static constexpr Row EMPTY_ROW = ~BOARD_BITS;
+    static constexpr Row FULL_ROW  = ~Row(0);
+
+    using Field = std::array<Row,H>;
+    using Cells = std::array<std::array<std::uint8_t,W>,H>;
+    using Skyline = std::array<int,W>;  // per column: row of the highest filled cell, H if empty
 
     Field field{};
-    int px = 3, py = 0, pr = 0; // active piece position + rotation
+    Cells cells{};              // piece id + 1 per cell, only used for rendering
+    Skyline column_top{};       // skyline of `field`, kept up to date by lock_piece / clear_lines
+    std::uint64_t board_hash = 0; // Zobrist hash of `field`, kept up to date incrementally
+    int px = SPAWN_X, py = 0, pr = 0; // active piece position + rotation
     int cur = 0, nxt = 0;       // current and next piece ids
 
     bool over = false;
@@ -31,16 +64,29 @@ struct Game {
     unsigned long colors[PIECE_COUNT];
     std::array<Piece,PIECE_COUNT> pieces;
 
-    // randomization (7-bag)
-    std::mt19937 rng;
-    std::vector<int> bag;
-    size_t bag_pos = 0;
+    // randomization (bag of all PIECE_COUNT pieces, reproducible from `seed`)
+    std::uint64_t seed = 0;
+    Rng rng;
+    std::array<int,PIECE_COUNT> bag{};
+    size_t bag_pos = PIECE_COUNT; // empty until the first refill
 
     struct ClearedRow {
         int row;
-        std::array<int,W> data;
+        std::array<std::uint8_t,W> data;
+    };
+    // fixed capacity: one piece spans at most 4 rows, so at most 4 clear at once
+    struct ClearedRows {
+        std::array<ClearedRow,4> rows;
+        int count = 0;
+
+        const ClearedRow* begin() const { return rows.data(); }
+        const ClearedRow* end() const { return rows.data() + count; }
+        bool empty() const { return count == 0; }
+        int size() const { return count; }
+        void clear() { count = 0; }
+        void push_back(const ClearedRow& r) { if(count < 4) rows[count++] = r; }
     };
-    std::vector<ClearedRow> cleared_rows;
+    ClearedRows cleared_rows;
     std::chrono::steady_clock::time_point flash_until{};
     bool flashing = false;
 
@@ -48,12 +94,27 @@ struct Game {
     int score = 0;
     int level = 1;
     int total_lines_cleared = 0;
+    int pieces_placed = 0;
 
     // fall speed
     std::chrono::milliseconds drop_ms{500};
 
-    // setup pieces and default colors
+    // timing: the engine never reads a clock itself, the caller feeds it the
+    // current time (wall clock in main.cpp, a simulated clock in benchmarks)
+    using clock = std::chrono::steady_clock;
+    static constexpr std::chrono::milliseconds LOCK_DELAY{500};
+    static constexpr std::chrono::milliseconds FLASH_TIME{240};
+    clock::time_point now{};
+    clock::time_point last_drop{};
+    clock::time_point lock_start{};
+    bool lock_timer_active = false;
+
+    // optional input log; every state change below is reported to it
+    ReplayRecorder* recorder = nullptr;
+
+    // setup pieces and default colors; without a seed the bag order is random
     void init();
+    void init(std::uint64_t seed);
 
     // reset game state
     void reset();
@@ -61,12 +122,57 @@ struct Game {
     // recalc drop speed by level
     void update_drop_interval();
 
+    // scoring rules shared with BatchGame
+    static int line_score(int lines,int level);
+    static int level_for_lines(int total_lines);
+
+    // shared piece table and board test, usable without a Game instance
+    static const Shape& shape(int id,int rot);
+    static bool collides(const Field& f,const Shape& s,int nx,int ny);
+
+    // skyline of any board, and the row where `s` comes to rest dropped
+    // straight down from row ny at column nx, read off it in one pass over
+    // the piece's columns: -1 when a cell of the piece is already at or
+    // below its column's top (tucked under an overhang), which the caller
+    // has to probe row by row instead
+    static void skyline(const Field& f,Skyline& top);
+    static int landing_row(const Skyline& top,const Shape& s,int nx,int ny);
+
+    // Zobrist hashing: one key per cell, plus keys for the current piece,
+    // next piece and bag position
+    static std::uint64_t row_hash(int r,Row bits);
+    static std::uint64_t row_move_hash(int from,int to,Row bits); // row_hash(from) ^ row_hash(to)
+    static std::uint64_t hash_field(const Field& f);
+    static std::uint64_t piece_key(int slot,int id); // slot 0..PIECE_COUNT-1 in the upcoming queue
+    std::uint64_t hash() const;                     // board + cur + nxt + bag position
+
     // movement/collision helpers
     bool collides(int nx,int ny,int nr) const;
     void try_move(int dx,int dy,int dr);
+    int  shift(int dir,int max_steps); // slide up to max_steps columns towards dir (-1/1), returns columns moved
     void hard_drop();
+    int  drop_row() const;  // row the active piece lands on (ghost, hard drop), cached until it moves
+    void rebuild_skyline(); // after writing `field` directly
     void lock_piece();      // fix current piece and score
     int  clear_lines();     // returns number of cleared rows
     int  next_piece();
     void refill_bag();
+
+    // timing helpers, all relative to `now`
+    void set_time(clock::time_point t) { now = t; }
+    bool check_and_lock();  // lock delay; true if the piece was locked
+    void soft_drop();       // one row down or start/continue lock delay
+    bool update_flash();    // true if the line-clear flash just ended
+    bool tick();            // lock delay + gravity; true if the state changed
+    // earliest time at which tick() or update_flash() can change the state
+    // (gravity, lock delay or flash end), time_point::max() if never
+    clock::time_point next_deadline() const;
+
+private:
+    void record_move(int dx,int dy,int dr);
+
+    // drop_row() cache: valid while the piece and the board epoch are unchanged
+    std::uint32_t board_epoch = 0;  // bumped on every change of `field`
+    mutable std::uint64_t drop_key = ~std::uint64_t(0);
+    mutable int drop_y = 0;
 };
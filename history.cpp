@@ -0,0 +1,137 @@
+#include "history.h"
+#include "replay.h"
+
+History::History(std::size_t max_snapshots)
+    : snaps(max_snapshots), rows(max_snapshots * Game::H)
+{
+    clear();
+}
+
+void History::clear(){
+    head = tail = 0;
+    row_head = 0;
+    last_keyframe = 0;
+    last_pieces = -1;
+}
+
+std::size_t History::bytes() const{
+    return snaps.size() * sizeof(Snapshot) + rows.size() * sizeof(RowRecord);
+}
+
+void History::push(const Game& g){
+    bool keyframe = head == tail || head - last_keyframe >= KEYFRAME_EVERY;
+    std::uint32_t changed = 0;
+    int count = 0;
+    for(int r=0;r<Game::H;++r){
+        if(keyframe || g.field[r] != last_field[r] || g.cells[r] != last_cells[r]){
+            changed |= 1u << r;
+            ++count;
+        }
+    }
+
+    // make room in both rings, oldest first
+    while(head - tail >= snaps.size() ||
+          (head > tail && row_head + count - at(tail).row_start > rows.size()))
+        ++tail;
+
+    Snapshot& s = at(head);
+    s.row_start = row_head;
+    s.changed = changed;
+    s.keyframe = keyframe;
+    for(int r=0;r<Game::H;++r){
+        if(!(changed & (1u << r))) continue;
+        rows[row_head++ % rows.size()] = RowRecord{g.field[r], g.cells[r]};
+    }
+
+    s.rng_state = g.rng.state;
+    s.rng_inc = g.rng.inc;
+    s.board_hash = g.board_hash;
+    s.score = g.score;
+    s.lines = g.total_lines_cleared;
+    s.pieces = g.pieces_placed;
+    s.level = static_cast<std::int16_t>(g.level);
+    s.px = static_cast<std::int8_t>(g.px);
+    s.py = static_cast<std::int8_t>(g.py);
+    s.pr = static_cast<std::int8_t>(g.pr);
+    s.cur = static_cast<std::int8_t>(g.cur);
+    s.nxt = static_cast<std::int8_t>(g.nxt);
+    s.bag_pos = static_cast<std::int8_t>(g.bag_pos);
+    for(int i=0;i<Game::PIECE_COUNT;++i) s.bag[i] = static_cast<std::int8_t>(g.bag[i]);
+    s.over = g.over;
+
+    if(keyframe) last_keyframe = head;
+    ++head;
+    last_field = g.field;
+    last_cells = g.cells;
+    last_pieces = g.pieces_placed;
+}
+
+bool History::sync(const Game& g){
+    if(g.pieces_placed == last_pieces) return false;
+    push(g);
+    return true;
+}
+
+std::uint64_t History::first_restorable() const{
+    // snapshots before the oldest surviving keyframe have lost their base
+    std::uint64_t s = tail;
+    while(s < head && !at(s).keyframe) ++s;
+    return s;
+}
+
+int History::size() const{
+    return static_cast<int>(head - first_restorable());
+}
+
+bool History::rewind(Game& g, int back){
+    if(back < 0 || back >= size()) return false;
+    std::uint64_t target = head - 1 - static_cast<std::uint64_t>(back);
+    std::uint64_t kf = target;
+    while(!at(kf).keyframe) --kf;
+
+    // keyframe plus at most KEYFRAME_EVERY-1 deltas
+    for(std::uint64_t seq = kf; seq <= target; ++seq){
+        const Snapshot& s = at(seq);
+        std::uint64_t src = s.row_start;
+        for(int r=0;r<Game::H;++r){
+            if(!(s.changed & (1u << r))) continue;
+            const RowRecord& rec = rows[src++ % rows.size()];
+            g.field[r] = rec.row;
+            g.cells[r] = rec.cells;
+        }
+    }
+
+    g.rebuild_skyline();
+
+    const Snapshot& s = at(target);
+    g.rng.state = s.rng_state;
+    g.rng.inc = s.rng_inc;
+    g.board_hash = s.board_hash;
+    g.score = s.score;
+    g.total_lines_cleared = s.lines;
+    g.pieces_placed = s.pieces;
+    g.level = s.level;
+    g.px = s.px; g.py = s.py; g.pr = s.pr;
+    g.cur = s.cur; g.nxt = s.nxt;
+    g.bag_pos = static_cast<size_t>(s.bag_pos);
+    for(int i=0;i<Game::PIECE_COUNT;++i) g.bag[i] = s.bag[i];
+    g.over = s.over;
+    g.paused = false;
+    g.flashing = false;
+    g.cleared_rows.clear();
+    g.lock_timer_active = false;
+    g.last_drop = g.now;
+    g.update_drop_interval();
+    if(g.recorder) g.recorder->add(ReplayEvent::Rewind, g.now, back);
+
+    // drop the undone snapshots and their rows
+    head = target + 1;
+    std::uint64_t used = 0;
+    for(int r=0;r<Game::H;++r) used += (s.changed >> r) & 1u;
+    row_head = s.row_start + used;
+    if(last_keyframe >= head) last_keyframe = kf;
+    last_field = g.field;
+    last_cells = g.cells;
+    last_pieces = g.pieces_placed;
+    return true;
+}
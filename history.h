@@ -0,0 +1,70 @@
+#pragma once
+
+#include "game.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bounded rewind history. Each snapshot keeps the small scalar state in
+// full but only the board rows that changed since the previous snapshot;
+// every KEYFRAME_EVERY-th snapshot stores all rows, so restoring any
+// snapshot replays at most that many deltas. Snapshots and rows live in two
+// fixed rings allocated up front. The row ring has room for every snapshot
+// to store every row, so the snapshot ring always wraps first: at least
+// max_snapshots - KEYFRAME_EVERY + 1 snapshots stay restorable.
+class History {
+public:
+    static constexpr int KEYFRAME_EVERY = 32;
+
+    explicit History(std::size_t max_snapshots = 2048);
+
+    void clear();
+    void push(const Game& g);
+    // push if a piece was placed since the last snapshot; true if it pushed
+    bool sync(const Game& g);
+
+    int size() const; // snapshots that can still be restored
+
+    // restore the snapshot `back` steps before the newest one (0 = newest)
+    // and forget everything after it
+    bool rewind(Game& g, int back);
+
+    std::size_t bytes() const;
+
+private:
+    struct RowRecord {
+        Row row;
+        std::array<std::uint8_t,Game::W> cells;
+    };
+
+    struct Snapshot {
+        std::uint64_t row_start = 0; // first row in the row ring
+        std::uint32_t changed = 0;   // bit r set = row r stored
+        bool keyframe = false;
+
+        std::uint64_t rng_state = 0, rng_inc = 0;
+        std::uint64_t board_hash = 0;
+        std::int32_t score = 0, lines = 0, pieces = 0;
+        std::int16_t level = 1;
+        std::int8_t px = 0, py = 0, pr = 0, cur = 0, nxt = 0, bag_pos = 0;
+        std::array<std::int8_t,Game::PIECE_COUNT> bag{};
+        bool over = false;
+    };
+    static_assert(Game::H <= 32, "changed-row mask holds one bit per row");
+
+    Snapshot& at(std::uint64_t seq) { return snaps[seq % snaps.size()]; }
+    const Snapshot& at(std::uint64_t seq) const { return snaps[seq % snaps.size()]; }
+    std::uint64_t first_restorable() const;
+
+    std::vector<Snapshot> snaps;
+    std::vector<RowRecord> rows;
+    std::uint64_t head = 0, tail = 0;   // snapshot sequence numbers [tail, head)
+    std::uint64_t row_head = 0;
+    std::uint64_t last_keyframe = 0;
+    int last_pieces = -1;
+
+    // board as of the newest snapshot, to diff the next one against
+    Game::Field last_field{};
+    Game::Cells last_cells{};
+};
@@ -0,0 +1,92 @@
+#include "input.h"
+#include <algorithm>
+
+bool AutoShift::press(Key k, Game& game){
+    if(held[k]) return false;
+    held[k] = true;
+    if(k == Down){
+        drop_at = game.now + timing.soft_drop;
+        if(drop(game, timing.soft_drop.count() == 0 ? Game::H : 1)) return true;
+        game.soft_drop();   // resting: starts or checks the lock delay
+        return false;
+    }
+    dir = k == Left ? -1 : 1;
+    shift_at = game.now + timing.das;
+    charged = false;
+    return shift(game, 1);
+}
+
+void AutoShift::release(Key k, const Game& game){
+    held[k] = false;
+    if(k == Down) return;
+    int d = k == Left ? -1 : 1;
+    if(dir != d) return;
+    // the other direction takes over if it is still held, after a fresh delay
+    if(held[k == Left ? Right : Left]){
+        dir = -d;
+        shift_at = game.now + timing.das;
+        charged = false;
+    } else {
+        dir = 0;
+    }
+}
+
+void AutoShift::release_all(){
+    for(bool& h: held) h = false;
+    dir = 0;
+}
+
+bool AutoShift::update(Game& game){
+    if(game.over || game.paused){
+        // presses are not delivered while paused, so neither are releases
+        release_all();
+        return false;
+    }
+    const auto now = game.now;
+    bool moved = false;
+
+    if(dir && now >= shift_at){
+        if(timing.arr.count() == 0){
+            // stays against the wall, also for the pieces that follow
+            charged = true;
+            moved |= shift(game, Game::W);
+        } else {
+            auto due = 1 + (now - shift_at) / timing.arr;
+            shift_at += due * timing.arr;
+            moved |= shift(game, static_cast<int>(std::min<decltype(due)>(due, Game::W)));
+        }
+    }
+
+    if(held[Down] && now >= drop_at){
+        if(timing.soft_drop.count() == 0){
+            moved |= drop(game, Game::H);
+        } else {
+            auto due = 1 + (now - drop_at) / timing.soft_drop;
+            drop_at += due * timing.soft_drop;
+            moved |= drop(game, static_cast<int>(std::min<decltype(due)>(due, Game::H)));
+        }
+    }
+    return moved;
+}
+
+Game::clock::time_point AutoShift::next_deadline() const{
+    // 0 ms repeats reapply on every update() and need no timer of their own
+    auto t = Game::clock::time_point::max();
+    if(dir && !charged) t = std::min(t, shift_at);
+    if(held[Down] && timing.soft_drop.count() != 0) t = std::min(t, drop_at);
+    return t;
+}
+
+bool AutoShift::shift(Game& game, int steps){
+    return game.shift(dir, steps) > 0;
+}
+
+bool AutoShift::drop(Game& game, int steps){
+    // a resting piece is left to Game::tick's lock delay
+    int moved = 0;
+    while(moved < steps && !game.collides(game.px, game.py+1, game.pr)){
+        game.soft_drop();
+        ++moved;
+    }
+    return moved > 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "game.h"
+#include <chrono>
+
+// Repeat timings for held keys, all measured on the game clock.
+struct InputTiming {
+    std::chrono::milliseconds das{133};        // delay before a held shift repeats
+    std::chrono::milliseconds arr{33};         // shift repeat interval; 0 = straight to the wall
+    std::chrono::milliseconds soft_drop{33};   // soft drop repeat interval; 0 = straight down
+};
+
+// Delayed auto shift for held keys, driven by key press/release
+// transitions instead of the X server's keyboard auto-repeat. A shift key
+// moves the piece once when pressed, again `das` later and then every
+// `arr`; when both are held the one pressed last wins. Soft drop steps on
+// its own interval. Like the engine, it never reads a clock: everything is
+// relative to game.now, so the caller arms its timer for next_deadline().
+class AutoShift {
+public:
+    enum Key { Left, Right, Down, KEY_COUNT };
+
+    InputTiming timing;
+
+    // a press also performs the first step (a soft drop on a resting piece
+    // starts the lock delay); repeated presses of a held key (detectable
+    // auto-repeat) are ignored. True if the piece moved.
+    bool press(Key k, Game& game);
+    void release(Key k, const Game& game);
+    void release_all();   // focus lost, pause, game over
+
+    // repeat steps due at game.now; true if the piece moved
+    bool update(Game& game);
+
+    // when update() next has work, time_point::max() if no key repeats
+    Game::clock::time_point next_deadline() const;
+
+private:
+    bool shift(Game& game, int steps);
+    bool drop(Game& game, int steps);
+
+    bool held[KEY_COUNT]{};
+    int dir = 0;                              // active shift: -1, 0 or 1
+    bool charged = false;                     // 0 ms ARR: shift_at passed, pinned to the wall
+    Game::clock::time_point shift_at{};       // next shift repeat
+    Game::clock::time_point drop_at{};        // next soft drop repeat
+};
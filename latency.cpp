@@ -0,0 +1,90 @@
+#include "latency.h"
+#include <algorithm>
+#include <cmath>
+
+int LatencyHistogram::bucket(std::uint64_t v){
+    if(v < SUB) return static_cast<int>(v);
+    int e = 63 - __builtin_clzll(v);
+    int sub = static_cast<int>((v >> (e - SUB_BITS)) & (SUB - 1));
+    return (e - SUB_BITS + 1) * SUB + sub;
+}
+
+std::uint64_t LatencyHistogram::bucket_upper(int b){
+    if(b < SUB) return static_cast<std::uint64_t>(b);
+    int e = b / SUB + SUB_BITS - 1;
+    std::uint64_t lower = static_cast<std::uint64_t>(SUB + b % SUB) << (e - SUB_BITS);
+    return lower + (std::uint64_t(1) << (e - SUB_BITS)) - 1;
+}
+
+void LatencyHistogram::record(std::int64_t ns){
+    if(ns < 0) ns = 0;
+    counts[bucket(static_cast<std::uint64_t>(ns))].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    std::int64_t m = max_ns.load(std::memory_order_relaxed);
+    while(ns > m && !max_ns.compare_exchange_weak(m, ns, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::reset(){
+    for(auto& c: counts) c.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    max_ns.store(0, std::memory_order_relaxed);
+}
+
+std::int64_t LatencyHistogram::percentile(double q) const{
+    std::uint64_t n = count();
+    if(!n) return 0;
+    auto target = static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * n));
+    target = std::max<std::uint64_t>(target, 1);
+    std::uint64_t seen = 0;
+    for(int b=0;b<BUCKETS;++b){
+        seen += counts[b].load(std::memory_order_relaxed);
+        if(seen >= target)
+            return std::min(static_cast<std::int64_t>(bucket_upper(b)), max());
+    }
+    return max();
+}
+
+void LatencyProbe::key_received(unsigned long server_ms, clock::time_point received){
+    auto recv_ms = std::chrono::duration_cast<std::chrono::milliseconds>(received.time_since_epoch()).count();
+    // server time is 32 bits of milliseconds; the offset only needs to be stable
+    std::int64_t offset = recv_ms - static_cast<std::int64_t>(server_ms & 0xffffffffu);
+    if(!have_offset || offset < min_offset_ms){
+        min_offset_ms = offset;
+        have_offset = true;
+    }
+    queue.record((offset - min_offset_ms) * 1'000'000);
+    if(pending_count < MAX_PENDING) pending[pending_count++] = received;
+}
+
+bool LatencyProbe::frame_done(bool presented, clock::time_point done){
+    if(!presented){
+        // nothing changed on screen: the presses had no visible effect
+        pending_count = 0;
+        return false;
+    }
+    for(int i=0;i<pending_count;++i)
+        input.record(std::chrono::duration_cast<std::chrono::nanoseconds>(done - pending[i]).count());
+    pending_count = 0;
+    return frames++ % SYNC_EVERY == 0;
+}
+
+void LatencyProbe::sync_done(clock::duration rtt){
+    sync.record(std::chrono::duration_cast<std::chrono::nanoseconds>(rtt).count());
+}
+
+void LatencyProbe::summary(char* line1, char* line2, int size) const{
+    auto ms = [](std::int64_t ns){ return ns / 1e6; };
+    std::snprintf(line1, size, "Lag p50 %.2f ms", ms(input.percentile(0.50)));
+    std::snprintf(line2, size, "p99 %.2f max %.2f", ms(input.percentile(0.99)), ms(input.max()));
+}
+
+void LatencyProbe::dump(std::FILE* fp) const{
+    auto line = [fp](const char* name, const LatencyHistogram& h){
+        std::fprintf(fp, "%-14s n=%-8llu p50 %8.3f ms  p99 %8.3f ms  max %8.3f ms\n", name,
+                     static_cast<unsigned long long>(h.count()),
+                     h.percentile(0.50) / 1e6, h.percentile(0.99) / 1e6, h.max() / 1e6);
+    };
+    line("input->display", input);
+    line("event queue", queue);
+    line("xsync rtt", sync);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Lock-free log-linear histogram of durations in nanoseconds: values below
+// 16 have their own bucket, above that every power of two is split into 16
+// buckets, so a percentile is exact to within 1/16 of its value. Counters
+// are relaxed atomics; any thread may record or read at any time, and a
+// read racing a record at worst misses that sample.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB = 1 << SUB_BITS;
+    static constexpr int BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    void record(std::int64_t ns);
+    void reset();
+
+    std::uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    std::int64_t max() const { return max_ns.load(std::memory_order_relaxed); }
+    // upper bound of the bucket holding quantile q (0..1), 0 when empty
+    std::int64_t percentile(double q) const;
+
+private:
+    static int bucket(std::uint64_t v);
+    static std::uint64_t bucket_upper(int b);
+
+    std::array<std::atomic<std::uint64_t>,BUCKETS> counts{};
+    std::atomic<std::uint64_t> total{0};
+    std::atomic<std::int64_t> max_ns{0};
+};
+
+// Input-to-display latency probe for the X11 game. For each key press it
+// keeps the X server timestamp and the monotonic receive time; when the
+// frame showing its effect has been blitted and flushed, the press's
+// latency goes into `input`. Server timestamps are on the server's own
+// millisecond clock, so `queue` holds how much longer than the fastest
+// press seen so far an event took from the server to the client. `sync`
+// holds sampled XSync round trips. Everything is caller-timed, no X11 here.
+class LatencyProbe {
+public:
+    using clock = std::chrono::steady_clock;
+    static constexpr int SYNC_EVERY = 16;   // presented frames per XSync sample
+
+    LatencyHistogram input, queue, sync;
+
+    void key_received(unsigned long server_ms, clock::time_point received);
+    // a frame was presented at `done` (true) or had nothing to show (false);
+    // true when the caller should time an XSync round trip for it
+    bool frame_done(bool presented, clock::time_point done);
+    void sync_done(clock::duration rtt);
+
+    // two short lines for the side panel
+    void summary(char* line1, char* line2, int size) const;
+    void dump(std::FILE* fp) const;
+
+private:
+    static constexpr int MAX_PENDING = 32;
+    std::array<clock::time_point,MAX_PENDING> pending{};
+    int pending_count = 0;
+    bool have_offset = false;
+    std::int64_t min_offset_ms = 0;   // smallest receive time minus server time
+    std::uint64_t frames = 0;
+};
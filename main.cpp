@@ -1,24 +1,139 @@
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <memory>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "ai.h"
 #include "game.h"
+#include "history.h"
+#include "input.h"
+#include "latency.h"
 #include "render.h"
+#include "replay.h"
+#include "telemetry.h"
+#include "trace.h"
 
-constexpr std::chrono::milliseconds LOCK_DELAY{500};
-
-int main(){
+int main(int argc, char** argv){
+    TRACE_THREAD();
+    using clock = Game::clock;
     Game game;
-    game.init();
+
+    // autoplay: the AI picks a placement for every new piece (--ai or A key)
+    bool autoplay = false;
+    bool software = false;           // --renderer shm: client-side rasterizer
+    bool full_redraw = false;        // --full-redraw: no damage tracking
+    bool show_latency = false;       // --latency or L: latency readout in the panel
+    bool dump_latency = false;       // --latency: histograms to stderr on exit
+    bool telemetry_on = true;        // --no-telemetry: no shared memory stats
+    bool seeded = false;
+    std::uint64_t seed = 0;
+    bool record = true;              // every session is logged unless --no-record
+    const char* record_path = nullptr;
+    const char* trace_path = "tetris-trace.json";  // --trace FILE, TETRIS_TRACE builds
+    AutoShift input;                 // --das / --arr / --soft-drop MS
+    Ai::Weights ai_weights;          // --weights FILE
+    int ai_depth = -1;               // --ai-depth N, -1 keeps the Ai default
+    // held-key timings: whole milliseconds, 0 or more
+    auto parse_ms = [&](const char* opt, const char* text, std::chrono::milliseconds& out){
+        char* end = nullptr;
+        errno = 0;
+        long ms = std::strtol(text, &end, 10);
+        if(end == text || *end || errno || ms < 0 || ms > 60000){
+            std::fprintf(stderr, "invalid %s %s\nusage: %s [%s MS] (0..60000)\n",
+                         opt, text, argv[0], opt);
+            return false;
+        }
+        out = std::chrono::milliseconds(ms);
+        return true;
+    };
+    for(int i=1;i<argc;++i){
+        if(!std::strcmp(argv[i], "--ai")) autoplay = true;
+        else if(!std::strcmp(argv[i], "--no-record")) record = false;
+        else if(!std::strcmp(argv[i], "--no-telemetry")) telemetry_on = false;
+        else if(!std::strcmp(argv[i], "--renderer") && i+1 < argc){
+            const char* name = argv[++i];
+            if(!std::strcmp(name, "shm")) software = true;
+            else if(!std::strcmp(name, "xlib") || !std::strcmp(name, "core")) software = false;
+            else {
+                std::fprintf(stderr, "unknown renderer %s\nusage: %s [--renderer xlib|core|shm]\n",
+                             name, argv[0]);
+                return 2;
+            }
+        }
+        else if(!std::strcmp(argv[i], "--full-redraw")) full_redraw = true;
+        else if(!std::strcmp(argv[i], "--latency")) show_latency = dump_latency = true;
+        else if(!std::strcmp(argv[i], "--record") && i+1 < argc) record_path = argv[++i];
+        else if(!std::strcmp(argv[i], "--trace") && i+1 < argc) trace_path = argv[++i];
+        else if(!std::strcmp(argv[i], "--seed") && i+1 < argc){
+            seed = std::strtoull(argv[++i], nullptr, 0);
+            seeded = true;
+        }
+        else if(!std::strcmp(argv[i], "--das") && i+1 < argc){
+            if(!parse_ms(argv[i], argv[i+1], input.timing.das)) return 2;
+            ++i;
+        }
+        else if(!std::strcmp(argv[i], "--arr") && i+1 < argc){
+            if(!parse_ms(argv[i], argv[i+1], input.timing.arr)) return 2;
+            ++i;
+        }
+        else if(!std::strcmp(argv[i], "--soft-drop") && i+1 < argc){
+            if(!parse_ms(argv[i], argv[i+1], input.timing.soft_drop)) return 2;
+            ++i;
+        }
+        else if(!std::strcmp(argv[i], "--ai-depth") && i+1 < argc)
+            ai_depth = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--weights") && i+1 < argc){
+            const char* path = argv[++i];
+            if(!Ai::load_weights(path, ai_weights)){
+                std::fprintf(stderr, "cannot load weights from %s\n", path);
+                return 1;
+            }
+        }
+    }
+
+    game.set_time(clock::now());
+    if(seeded) game.init(seed);
+    else game.init();
+
+    ReplayRecorder recorder;
+    if(record){
+        char default_path[64];
+        if(!record_path){
+            ::mkdir("replays", 0755);
+            std::snprintf(default_path, sizeof(default_path), "replays/%lld-%d.ttr",
+                          static_cast<long long>(std::time(nullptr)), static_cast<int>(::getpid()));
+            record_path = default_path;
+        }
+        if(recorder.open(record_path, game.seed, game.now))
+            game.recorder = &recorder;
+        else
+            std::fprintf(stderr, "cannot record replay to %s\n", record_path);
+    }
+    int ai_piece = -1; // pieces_placed value the AI last moved for
+    // the search pool and its table are only built once autoplay first starts
+    std::unique_ptr<Ai> ai;
+
+    // one snapshot per placed piece; Z steps back a piece. The replay
+    // verifier snapshots at the same points, so rewinds replay exactly.
+    History history;
+    history.push(game);
 
     Display* dpy = XOpenDisplay(nullptr);
     if(!dpy) return 1;
     int screen = DefaultScreen(dpy);
 
-    int board_w = Game::W*TILE + 2*MARGIN;
-    int board_h = Game::H*TILE + 2*MARGIN;
-    int width   = board_w + PANEL_W;
-    int height  = board_h;
+    Layout layout = Layout::standard();
+    int width   = layout.width;
+    int height  = layout.height;
 
     Window win = XCreateSimpleWindow(
         dpy, RootWindow(dpy,screen),
@@ -28,153 +143,276 @@ int main(){
     );
     XStoreName(dpy, win, "Tetris (Xlib)");
 
-    long mask = ExposureMask | KeyPressMask | ButtonPressMask | StructureNotifyMask;
+    // key releases drive the game's own auto-repeat (AutoShift); focus
+    // changes release every held key
+    long mask = ExposureMask | KeyPressMask | KeyReleaseMask | ButtonPressMask |
+                StructureNotifyMask | FocusChangeMask;
     XSelectInput(dpy, win, mask);
     Atom wm_delete = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
     XSetWMProtocols(dpy, win, &wm_delete, 1);
     XMapWindow(dpy, win);
-    GC gc = XCreateGC(dpy, win, 0, nullptr);
-
-    Rect pause_btn{}, exit_btn{}, ghost_btn{};
-    int btn_w = PANEL_W - 2*MARGIN;
-    int btn_h = 28;
-    int btn_x = board_w + MARGIN;
-    int preview_bottom = MARGIN + 18 + TILE*4;
-    int text_block_bottom = preview_bottom + 60;
-    int btn_y1 = text_block_bottom + 20;
-    pause_btn = {btn_x, btn_y1, btn_w, btn_h};
-    exit_btn  = {btn_x, btn_y1 + btn_h + 8, btn_w, btn_h};
-    int ghost_h = 22;
-    int ghost_y = exit_btn.y + exit_btn.h + 73;
-    ghost_btn = {btn_x, ghost_y, btn_w, ghost_h};
-
-    using clock = std::chrono::steady_clock;
-    auto last_drop = clock::now();
-    bool lock_timer_active = false;
-    clock::time_point lock_start{};
-
-    auto check_and_lock = [&](const clock::time_point& now){
-        bool touching = game.collides(game.px, game.py+1, game.pr);
-        if(!touching){
-            lock_timer_active = false;
-            return false;
-        }
-        if(!lock_timer_active){
-            lock_timer_active = true;
-            lock_start = now;
-            return false;
-        }
-        if(now - lock_start >= LOCK_DELAY){
-            game.lock_piece();
-            lock_timer_active = false;
-            last_drop = now;
-            return true;
-        }
-        return false;
-    };
 
+    LatencyProbe probe;
+
+    // live stats in shared memory for tetris_top; only published, never read here
+    TelemetryPublisher telemetry;
+    if(telemetry_on && !telemetry.open())
+        std::fprintf(stderr, "cannot create telemetry segment\n");
+    TelemetryStats stats{};
+    stats.pid = ::getpid();
+    LatencyHistogram frame_time;
+    unsigned long long total_requests = 0;
+    clock::time_point game_start = game.now;
+    bool was_over = false;
+    RenderContext ctx;
+    ctx.init(dpy, win, width, height, game, software);
+    ctx.incremental = !full_redraw;
+
+    // Event loop: block until the X connection is readable or the timer for
+    // the game's next deadline (gravity, lock delay, flash) fires, handle
+    // everything pending, then render at most once per wakeup.
+    int xfd = ConnectionNumber(dpy);
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(tfd < 0){
+        std::perror("timerfd_create");
+        return 1;
+    }
+    bool dirty = true;   // the game changed since the last render
     while(true){
+        TRACE_SCOPE("loop");
+        TRACE_PHASES(phase, "events");
         while(XPending(dpy)){
             XEvent e;
             XNextEvent(dpy, &e);
+            if(ctx.event(e)) continue;
             if(e.type == Expose){
-                render(dpy, win, gc, game, pause_btn, exit_btn, ghost_btn);
+                if(!ctx.expose(e.xexpose))
+                    dirty = true;
+            } else if(e.type == ConfigureNotify){
+                ctx.resize(e.xconfigure.width, e.xconfigure.height);
             } else if(e.type == ClientMessage){
                 if(static_cast<Atom>(e.xclient.data.l[0]) == wm_delete)
                     goto end;
+            } else if(e.type == FocusOut){
+                input.release_all();
+            } else if(e.type == KeyRelease){
+                // server auto-repeat comes as a release immediately followed by
+                // a press of the same key with the same timestamp: drop both
+                if(XEventsQueued(dpy, QueuedAfterReading)){
+                    XEvent next;
+                    XPeekEvent(dpy, &next);
+                    if(next.type == KeyPress && next.xkey.keycode == e.xkey.keycode &&
+                       next.xkey.time == e.xkey.time){
+                        XNextEvent(dpy, &next);
+                        continue;
+                    }
+                }
+                KeySym ks = XLookupKeysym(&e.xkey,0);
+                game.set_time(clock::now());
+                if(ks == XK_Left) input.release(AutoShift::Left, game);
+                else if(ks == XK_Right) input.release(AutoShift::Right, game);
+                else if(ks == XK_Down) input.release(AutoShift::Down, game);
             } else if(e.type == KeyPress){
+                probe.key_received(e.xkey.time, clock::now());
                 KeySym ks = XLookupKeysym(&e.xkey,0);
                 if(ks == XK_Escape) goto end;
 
+                if(ks == XK_l){
+                    show_latency = !show_latency;
+                    dirty = true;
+                    continue;
+                }
+
+                if(ks == XK_z){
+                    game.set_time(clock::now());
+                    if(history.rewind(game, history.size() > 1 ? 1 : 0))
+                        dirty = true;
+                    continue;
+                }
+
                 if(game.over && ks == XK_r){
+                    game.set_time(clock::now());
                     game.reset();
-                    lock_timer_active = false;
-                    render(dpy, win, gc, game, pause_btn, exit_btn, ghost_btn);
+                    game_start = game.now;
+                    history.clear();
+                    history.push(game);
+                    dirty = true;
                     continue;
                 }
                 if(game.over) continue;
 
                 if(ks == XK_p){
                     game.paused = !game.paused;
-                    render(dpy, win, gc, game, pause_btn, exit_btn, ghost_btn);
+                    dirty = true;
                     continue;
                 }
                 if(game.paused) continue;
 
-                auto now = clock::now();
+                if(ks == XK_a){
+                    autoplay = !autoplay;
+                    ai_piece = -1;
+                    continue;
+                }
+
+                game.set_time(clock::now());
                 if(ks == XK_Left){
-                    game.try_move(-1,0,0);
-                    check_and_lock(now);
+                    input.press(AutoShift::Left, game);
+                    game.check_and_lock();
                 } else if(ks == XK_Right){
-                    game.try_move(1,0,0);
-                    check_and_lock(now);
+                    input.press(AutoShift::Right, game);
+                    game.check_and_lock();
                 } else if(ks == XK_Up){
                     game.try_move(0,0,1);
-                    check_and_lock(now);
+                    game.check_and_lock();
                 } else if(ks == XK_Down){
-                    if(!game.collides(game.px,game.py+1,game.pr)){
-                        game.py++;
-                        last_drop = now;
-                    } else {
-                        check_and_lock(now);
-                    }
+                    input.press(AutoShift::Down, game);
                 } else if(ks == XK_space){
                     game.hard_drop();
-                    check_and_lock(now);
+                    game.check_and_lock();
                 }
-                render(dpy, win, gc, game, pause_btn, exit_btn, ghost_btn);
+                history.sync(game);
+                dirty = true;
             } else if(e.type == ButtonPress){
                 int mx = e.xbutton.x;
                 int my = e.xbutton.y;
                 auto inside = [](const Rect& r,int x,int y){
                     return x>=r.x && x<=r.x+r.w && y>=r.y && y<=r.y+r.h;
                 };
-                if(inside(exit_btn, mx,my)) goto end;
-                if(inside(ghost_btn, mx,my)){
+                if(inside(ctx.layout.exit_btn, mx,my)) goto end;
+                if(inside(ctx.layout.ghost_btn, mx,my)){
                     game.show_ghost = !game.show_ghost;
-                    render(dpy, win, gc, game, pause_btn, exit_btn, ghost_btn);
+                    dirty = true;
                     continue;
                 }
-                if(inside(pause_btn, mx,my)){
+                if(inside(ctx.layout.pause_btn, mx,my)){
                     game.paused = !game.paused;
-                    render(dpy, win, gc, game, pause_btn, exit_btn, ghost_btn);
+                    dirty = true;
                 }
             }
         }
 
-        auto now = clock::now();
-        if(game.flashing && now >= game.flash_until){
-            game.flashing = false;
-            game.cleared_rows.clear();
+        TRACE_NEXT(phase, "update");
+        game.set_time(clock::now());
+        const int placed = game.pieces_placed;
+        if(input.update(game)){
+            game.check_and_lock();
+            history.sync(game);
+            dirty = true;
         }
-        // if piece is resting, allow a short lock delay to nudge sideways/rotate
-        if(check_and_lock(now)){
-            render(dpy, win, gc, game, pause_btn, exit_btn, ghost_btn);
-            continue;
+        if(game.update_flash()) dirty = true;
+        if(game.tick()){
+            history.sync(game);
+            dirty = true;
         }
 
-        if(!game.over && !game.paused &&
-           now - last_drop >= game.drop_ms)
+        if(autoplay && !game.over && !game.paused &&
+           game.pieces_placed != ai_piece)
         {
-            if(!game.collides(game.px,game.py+1,game.pr)){
-                game.py++;
-            } else {
-                if(check_and_lock(now)){
-                    render(dpy, win, gc, game, pause_btn, exit_btn, ghost_btn);
-                    last_drop = now;
-                    continue;
-                }
+            if(!ai){
+                ai = std::make_unique<Ai>();
+                ai->use_tt(32);
+                ai->weights = ai_weights;
+                if(ai_depth >= 0) ai->depth = ai_depth;
+            }
+            ai_piece = game.pieces_placed;
+            Ai::apply(game, ai->choose(game));
+            game.check_and_lock();
+            history.sync(game);
+            dirty = true;
+        }
+
+        // 0 ms repeats have no deadline of their own, so they carry over to
+        // a piece spawned above now rather than at the next gravity step
+        if(game.pieces_placed != placed && input.update(game)){
+            game.check_and_lock();
+            history.sync(game);
+            dirty = true;
+        }
+
+        TRACE_NEXT(phase, "render");
+        if(show_latency)
+            probe.summary(ctx.status.line[0], ctx.status.line[1], PanelStatus::LEN);
+        else
+            ctx.status = PanelStatus{};
+        bool presented = false;
+        if(dirty){
+            auto r0 = clock::now();
+            ctx.render(game);
+            presented = ctx.frame_requests > 0;
+            if(presented){
+                frame_time.record(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - r0).count());
+                total_requests += ctx.frame_requests;
+                ++stats.frames;
+            }
+            dirty = false;
+            // render() returns after the blit has been flushed
+            if(probe.frame_done(ctx.frame_requests > 0, clock::now())){
+                auto t0 = clock::now();
+                XSync(dpy, False);
+                probe.sync_done(clock::now() - t0);
             }
-            last_drop = now;
-            render(dpy, win, gc, game, pause_btn, exit_btn, ghost_btn);
+        } else {
+            probe.frame_done(false, clock::now());
         }
 
-        struct timespec ts{0, 2'000'000};
-        nanosleep(&ts, nullptr);
+        if(game.over && !was_over) ++stats.game_overs;
+        was_over = game.over;
+        ++stats.wakeups;
+        if(!presented) ++stats.idle_wakeups;
+        if(telemetry.is_open()){
+            stats.score = game.score;
+            stats.level = game.level;
+            stats.lines = game.total_lines_cleared;
+            stats.pieces = game.pieces_placed;
+            double secs = std::chrono::duration<double>(game.now - game_start).count();
+            stats.pieces_per_sec = secs > 0 ? game.pieces_placed / secs : 0;
+            stats.frame_us_p50 = frame_time.percentile(0.50) / 1e3;
+            stats.frame_us_p99 = frame_time.percentile(0.99) / 1e3;
+            stats.frame_us_max = frame_time.max() / 1e3;
+            stats.requests_per_frame = stats.frames ? double(total_requests) / stats.frames : 0;
+            telemetry.publish(stats);
+        }
+
+        TRACE_NEXT(phase, "wait");
+        // absolute expiry on the same clock as Game::clock; an all-zero value
+        // would disarm the timer, so a due deadline becomes 1 ns
+        itimerspec its{};
+        auto deadline = std::min(game.next_deadline(), input.next_deadline());
+        if(deadline != clock::time_point::max()){
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+            if(ns < 1) ns = 1;
+            its.it_value.tv_sec = static_cast<time_t>(ns / 1'000'000'000);
+            its.it_value.tv_nsec = static_cast<long>(ns % 1'000'000'000);
+        }
+        timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, nullptr);
+
+        // XPending flushes our requests; events may have arrived meanwhile
+        if(XPending(dpy)) continue;
+        pollfd fds[2] = {{xfd, POLLIN, 0}, {tfd, POLLIN, 0}};
+        if(poll(fds, 2, -1) < 0 && errno != EINTR){
+            std::perror("poll");
+            break;
+        }
+        if(fds[1].revents & POLLIN){
+            std::uint64_t expirations;
+            ssize_t n = read(tfd, &expirations, sizeof(expirations));
+            (void)n;
+        }
     }
 
 end:
-    XFreeGC(dpy, gc);
+    ::close(tfd);
+    if(dump_latency) probe.dump(stderr);
+    telemetry.close();
+#if TETRIS_TRACE
+    if(!trace::write_chrome_json(trace_path))
+        std::fprintf(stderr, "cannot write trace to %s\n", trace_path);
+#else
+    (void)trace_path;
+#endif
+    game.set_time(clock::now());
+    recorder.finish(game);
+    ctx.release();
     XDestroyWindow(dpy, win);
     XCloseDisplay(dpy);
     return 0;
@@ -0,0 +1,262 @@
+//
+// Microbenchmarks for the Game hot operations on fixed board fixtures.
+// Results go to stdout (or --out FILE) as JSON so runs can be diffed. The
+// randomizer is also compared against the old mt19937 + std::shuffle path.
+//
+#include "game.h"
+#include <chrono>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+volatile long long sink = 0; // keeps results observable to the optimizer
+
+struct Result {
+    std::string name;
+    std::string fixture;
+    double ns_per_op;
+    long long iterations;
+};
+
+// tiny LCG so fixtures are identical on every run and platform
+struct Lcg {
+    unsigned state;
+    unsigned next(){ state = state*1664525u + 1013904223u; return state >> 8; }
+};
+
+void set_cell(Game& g, int r, int c, int id){
+    g.field[r] |= Row(1) << (c + Game::WALL);
+    g.cells[r][c] = static_cast<std::uint8_t>(id + 1);
+}
+
+// fill rows [from, H) leaving one or two random gaps per row
+void fill_rows(Game& g, int from, Lcg& lcg){
+    for(int r=from;r<Game::H;++r){
+        int gap1 = lcg.next() % Game::W;
+        int gap2 = lcg.next() % Game::W;
+        for(int c=0;c<Game::W;++c)
+            if(c != gap1 && c != gap2) set_cell(g, r, c, (r+c) % Game::PIECE_COUNT);
+    }
+}
+
+struct Fixture {
+    const char* name;
+    Game game;
+};
+
+std::vector<Fixture> make_fixtures(){
+    std::vector<Fixture> out;
+    Game base;
+    base.init(1); // fixed seed: same bag and next_piece sequence on every run
+    base.cur = 0; // I piece everywhere so fixtures are comparable
+    base.px = 3; base.py = 0; base.pr = 0;
+
+    out.push_back({"empty", base});
+
+    Lcg lcg{12345};
+    Fixture half{"half_filled", base};
+    fill_rows(half.game, Game::H/2, lcg);
+    out.push_back(half);
+
+    Fixture top{"near_topout", base};
+    fill_rows(top.game, 5, lcg);
+    out.push_back(top);
+
+    // four rows full except column 0, vertical I over the well: lock clears 4
+    Fixture multi{"multi_line_clear", base};
+    fill_rows(multi.game, Game::H/2, lcg);
+    for(int r=0;r<Game::H;++r){
+        multi.game.field[r] &= ~(Row(1) << Game::WALL);
+        multi.game.cells[r][0] = 0;
+    }
+    for(int r=Game::H-4;r<Game::H;++r)
+        for(int c=1;c<Game::W;++c) set_cell(multi.game, r, c, 5);
+    multi.game.pr = 3;  // I vertical, occupies local column 1
+    multi.game.px = -1;
+    out.push_back(multi);
+    for(Fixture& fx: out) fx.game.rebuild_skyline();
+    return out;
+}
+
+// copy back everything the measured operations mutate
+void restore(Game& g, const Game& f){
+    g.field = f.field;
+    g.cells = f.cells;
+    g.rebuild_skyline();
+    g.px = f.px; g.py = f.py; g.pr = f.pr;
+    g.cur = f.cur; g.nxt = f.nxt;
+    g.over = f.over;
+    g.score = f.score;
+    g.level = f.level;
+    g.total_lines_cleared = f.total_lines_cleared;
+    g.drop_ms = f.drop_ms;
+}
+
+// best-of-5 ns per call of op(i), minus the per-iteration cost of prep(i)
+template<class Prep, class Op>
+double measure(long long iters, Prep prep, Op op){
+    auto run = [&](bool with_op){
+        double best = 1e300;
+        for(int rep=0;rep<5;++rep){
+            auto t0 = bench_clock::now();
+            for(long long i=0;i<iters;++i){
+                prep(i);
+                if(with_op) op(i);
+            }
+            auto t1 = bench_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+            if(ns < best) best = ns;
+        }
+        return best;
+    };
+    double base = run(false);
+    double total = run(true);
+    double per = (total - base) / iters;
+    return per > 0 ? per : 0;
+}
+
+void run_fixture(const Fixture& fx, long long iters, std::vector<Result>& out){
+    Game g = fx.game;
+    const Game& f = fx.game;
+
+    // probe a spread of positions around the board for every rotation
+    struct Probe { int x, y, r; };
+    Probe probes[64];
+    for(int i=0;i<64;++i)
+        probes[i] = {i % Game::W - 1, (i*7) % Game::H, i % 4};
+
+    out.push_back({"collides", fx.name, measure(iters,
+        [](long long){},
+        [&](long long i){
+            const Probe& p = probes[i & 63];
+            sink += g.collides(p.x, p.y, p.r);
+        }), iters});
+
+    out.push_back({"try_move", fx.name, measure(iters,
+        [&](long long){ g.px = f.px; g.py = f.py; g.pr = f.pr; },
+        [&](long long i){
+            static const int moves[4][3] = {{-1,0,0},{1,0,0},{0,0,1},{0,1,0}};
+            const int* m = moves[i & 3];
+            g.try_move(m[0], m[1], m[2]);
+            sink += g.px;
+        }), iters});
+
+    out.push_back({"hard_drop", fx.name, measure(iters,
+        [&](long long){ g.py = f.py; },
+        [&](long long){ g.hard_drop(); sink += g.py; }), iters});
+
+    Game dropped = f;
+    dropped.hard_drop();
+    out.push_back({"lock_piece", fx.name, measure(iters,
+        [&](long long){ restore(g, dropped); },
+        [&](long long){ g.lock_piece(); sink += g.score; }), iters});
+
+    // clear_lines on the board as it looks right after the lock, before compaction
+    Game locked = dropped;
+    for(auto v: locked.pieces[locked.cur].rot[locked.pr]){
+        int gx = locked.px + v.x, gy = locked.py + v.y;
+        if(gy >= 0 && gy < Game::H && gx >= 0 && gx < Game::W)
+            set_cell(locked, gy, gx, locked.cur);
+    }
+    locked.rebuild_skyline();
+    out.push_back({"clear_lines", fx.name, measure(iters,
+        [&](long long){ restore(g, locked); },
+        [&](long long){ sink += g.clear_lines(); }), iters});
+
+    out.push_back({"next_piece", fx.name, measure(iters,
+        [](long long){},
+        [&](long long){ sink += g.next_piece(); }), iters});
+}
+
+struct RngResult {
+    const char* name;
+    std::size_t state_bytes;
+    double next_ns;
+    double bag_ns;  // refill + shuffle of one PIECE_COUNT bag
+};
+
+// the previous randomizer (mt19937 + std::shuffle) against the engine's Rng
+template<class Gen, class Shuffle>
+RngResult measure_rng(const char* name, Gen& gen, Shuffle shuffle, long long iters){
+    std::array<int,Game::PIECE_COUNT> bag{};
+    RngResult r{name, sizeof(Gen), 0, 0};
+    r.next_ns = measure(iters, [](long long){}, [&](long long){ sink += gen(); });
+    r.bag_ns = measure(iters,
+        [&](long long){ for(int i=0;i<Game::PIECE_COUNT;++i) bag[i] = i; },
+        [&](long long){ shuffle(bag, gen); sink += bag[0]; });
+    return r;
+}
+
+std::vector<RngResult> run_rng(long long iters){
+    std::vector<RngResult> out;
+    std::mt19937 mt(1);
+    out.push_back(measure_rng("mt19937+std::shuffle", mt,
+        [](std::array<int,Game::PIECE_COUNT>& b, std::mt19937& g){ std::shuffle(b.begin(), b.end(), g); },
+        iters));
+    Rng pcg(1);
+    out.push_back(measure_rng("pcg32", pcg,
+        [](std::array<int,Game::PIECE_COUNT>& b, Rng& g){ g.shuffle(b.begin(), b.end()); },
+        iters));
+    return out;
+}
+
+void write_json(std::FILE* fp, const std::vector<Result>& results,
+                const std::vector<RngResult>& rngs){
+    std::fprintf(fp, "{\n  \"game_bytes\": %zu,\n", sizeof(Game));
+    std::fprintf(fp, "  \"rng\": [\n");
+    for(size_t i=0;i<rngs.size();++i){
+        const RngResult& r = rngs[i];
+        std::fprintf(fp,
+            "    {\"name\": \"%s\", \"state_bytes\": %zu, \"next_ns\": %.3f, \"bag_ns\": %.3f}%s\n",
+            r.name, r.state_bytes, r.next_ns, r.bag_ns,
+            i+1 < rngs.size() ? "," : "");
+    }
+    std::fprintf(fp, "  ],\n  \"benchmarks\": [\n");
+    for(size_t i=0;i<results.size();++i){
+        const Result& r = results[i];
+        std::fprintf(fp,
+            "    {\"name\": \"%s\", \"fixture\": \"%s\", \"ns_per_op\": %.3f, \"iterations\": %lld}%s\n",
+            r.name.c_str(), r.fixture.c_str(), r.ns_per_op, r.iterations,
+            i+1 < results.size() ? "," : "");
+    }
+    std::fprintf(fp, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+    const char* out_path = nullptr;
+    long long iters = 200000;
+    for(int i=1;i<argc;++i){
+        if(!std::strcmp(argv[i], "--out") && i+1 < argc)
+            out_path = argv[++i];
+        else if(!std::strcmp(argv[i], "--iters") && i+1 < argc)
+            iters = std::atoll(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--out FILE] [--iters N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Result> results;
+    for(const auto& fx: make_fixtures())
+        run_fixture(fx, iters, results);
+
+    std::FILE* fp = out_path ? std::fopen(out_path, "w") : stdout;
+    if(!fp){
+        std::perror(out_path);
+        return 1;
+    }
+    write_json(fp, results, run_rng(iters));
+    if(fp != stdout) std::fclose(fp);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "offscreen.h"
+#include <cstring>
+
+OffscreenRenderer::OffscreenRenderer(const Game& game, Layout layout_)
+    : layout(layout_)
+{
+    // the framebuffer is 0x00RRGGBB, so colors are their own pixels
+    palette = resolve_palette(game, [](unsigned long rgb24){ return rgb24; });
+    raster.resize(layout.width, layout.height);
+    rgb.resize(static_cast<std::size_t>(layout.width) * layout.height * 3);
+}
+
+OffscreenRenderer::~OffscreenRenderer(){
+    close();
+}
+
+bool OffscreenRenderer::open(const char* path, Format format_){
+    close();
+    out = std::strcmp(path, "-") == 0 ? stdout : std::fopen(path, "wb");
+    format = format_;
+    return out != nullptr;
+}
+
+void OffscreenRenderer::close(){
+    if(!out) return;
+    if(out == stdout) std::fflush(out);
+    else std::fclose(out);
+    out = nullptr;
+}
+
+void OffscreenRenderer::render(const Game& game){
+    build_frame(list, palette, layout, game);
+    raster.draw(list);
+    raster.draw_text(list);
+    ++frames;
+    if(out) write_frame();
+}
+
+void OffscreenRenderer::write_frame(){
+    unsigned char* p = rgb.data();
+    for(int y=0;y<raster.height;++y){
+        const std::uint32_t* row = raster.pixels + y*raster.stride;
+        for(int x=0;x<raster.width;++x){
+            std::uint32_t px = row[x];
+            *p++ = static_cast<unsigned char>(px >> 16);
+            *p++ = static_cast<unsigned char>(px >> 8);
+            *p++ = static_cast<unsigned char>(px);
+        }
+    }
+    if(format == Format::Ppm)
+        std::fprintf(out, "P6\n%d %d\n255\n", raster.width, raster.height);
+    std::fwrite(rgb.data(), 1, rgb.size(), out);
+}
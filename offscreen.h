@@ -0,0 +1,41 @@
+#pragma once
+
+#include "raster.h"
+#include "renderer.h"
+#include <cstdio>
+#include <vector>
+
+// Headless Renderer: rasterizes each frame (text included, with the
+// built-in font) into memory as 0x00RRGGBB pixels. With a sink open,
+// every frame is also written out, either as a binary PPM (concatenated
+// PPMs are a valid image2pipe stream) or as bare RGB24, ready for e.g.
+// `ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -i -`.
+class OffscreenRenderer : public Renderer {
+public:
+    enum class Format { Ppm, Raw };
+
+    explicit OffscreenRenderer(const Game& game, Layout layout = Layout::standard());
+    ~OffscreenRenderer() override;
+    OffscreenRenderer(const OffscreenRenderer&) = delete;
+    OffscreenRenderer& operator=(const OffscreenRenderer&) = delete;
+
+    // "-" writes to stdout; a FIFO path works as a pipe
+    bool open(const char* path, Format format = Format::Ppm);
+    void close();
+
+    void render(const Game& game) override;
+
+    const Raster& frame() const { return raster; }
+    long long frames = 0;
+
+private:
+    void write_frame();
+
+    Layout layout;
+    Palette palette;
+    DrawList list;
+    Raster raster;
+    std::FILE* out = nullptr;
+    Format format = Format::Ppm;
+    std::vector<unsigned char> rgb;   // one frame, converted for output
+};
@@ -0,0 +1,129 @@
+#include "raster.h"
+#include "font.h"
+#include <algorithm>
+#include <cstdlib>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+void fill_span(std::uint32_t* p, int n, std::uint32_t px){
+    int i = 0;
+#if defined(__SSE2__)
+    __m128i v = _mm_set1_epi32(static_cast<int>(px));
+    for(; i + 8 <= n; i += 8){
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), v);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i + 4), v);
+    }
+#endif
+    for(; i < n; ++i) p[i] = px;
+}
+
+} // namespace
+
+void Raster::resize(int w, int h){
+    storage.assign(static_cast<std::size_t>(w) * h, 0);
+    attach(storage.data(), w, h, w);
+}
+
+void Raster::attach(std::uint32_t* data, int w, int h, int stride_pixels){
+    pixels = data;
+    width = w;
+    height = h;
+    stride = stride_pixels;
+    unclip();
+}
+
+void Raster::clip(int x,int y,int w,int h){
+    clip_x0 = std::max(x, 0);
+    clip_y0 = std::max(y, 0);
+    clip_x1 = std::min(x + w, width);
+    clip_y1 = std::min(y + h, height);
+}
+
+void Raster::fill(std::uint32_t px, int x,int y,int w,int h){
+    int x0 = std::max(x, clip_x0), x1 = std::min(x + w, clip_x1);
+    int y0 = std::max(y, clip_y0), y1 = std::min(y + h, clip_y1);
+    if(x0 >= x1) return;
+    for(int r=y0;r<y1;++r)
+        fill_span(pixels + r*stride + x0, x1 - x0, px);
+}
+
+void Raster::outline(std::uint32_t px, int x,int y,int w,int h, int dash){
+    if(!dash){
+        fill(px, x, y, w + 1, 1);
+        fill(px, x, y + h, w + 1, 1);
+        fill(px, x, y, 1, h + 1);
+        fill(px, x + w, y, 1, h + 1);
+        return;
+    }
+    // closed path: every edge stops short of its end point and the dash
+    // pattern runs on across corners
+    int i = 0;
+    auto step = [&](int cx, int cy){
+        if((i++ / dash) % 2 == 0) plot(px, cx, cy);
+    };
+    for(int k=0;k<w;++k) step(x + k, y);
+    for(int k=0;k<h;++k) step(x + w, y + k);
+    for(int k=0;k<w;++k) step(x + w - k, y + h);
+    for(int k=0;k<h;++k) step(x, y + h - k);
+}
+
+void Raster::line(std::uint32_t px, int x1,int y1,int x2,int y2){
+    if(y1 == y2){
+        fill(px, std::min(x1, x2), y1, std::abs(x2 - x1) + 1, 1);
+        return;
+    }
+    if(x1 == x2){
+        fill(px, x1, std::min(y1, y2), 1, std::abs(y2 - y1) + 1);
+        return;
+    }
+    int dx = std::abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+    int dy = -std::abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+    int err = dx + dy;
+    while(true){
+        plot(px, x1, y1);
+        if(x1 == x2 && y1 == y2) break;
+        int e2 = 2*err;
+        if(e2 >= dy){ err += dy; x1 += sx; }
+        if(e2 <= dx){ err += dx; y1 += sy; }
+    }
+}
+
+void Raster::text(std::uint32_t px, int x,int y, const char* s, int len){
+    for(int i=0;i<len;++i, x += FONT_ADVANCE){
+        char ch = s[i];
+        if(ch < FONT_FIRST || ch > FONT_LAST) ch = '?';
+        const std::uint8_t* glyph = FONT[ch - FONT_FIRST];
+        for(int r=0;r<FONT_H;++r)
+            for(int c=0;c<FONT_W;++c)
+                if(glyph[r] & (0x10 >> c)) plot(px, x + c, y - FONT_ASCENT + r);
+    }
+}
+
+void Raster::draw_text(const DrawList& dl){
+    for(const DrawList::Text& t: dl.text_items())
+        text(static_cast<std::uint32_t>(t.pixel), t.x, t.y, t.s, t.len);
+}
+
+void Raster::draw(const DrawList& dl){
+    for(std::size_t i=0;i<dl.size();++i){
+        const DrawList::Batch& b = dl[i];
+        auto px = static_cast<std::uint32_t>(b.pixel);
+        switch(b.kind){
+        case DrawList::Fill:
+            for(const XRectangle& r: b.rects) fill(px, r.x, r.y, r.width, r.height);
+            break;
+        case DrawList::Outline: {
+            int dash = b.style == DrawList::Ghost ? GHOST_DASH
+                     : b.style == DrawList::Flash ? FLASH_DASH : 0;
+            for(const XRectangle& r: b.rects) outline(px, r.x, r.y, r.width, r.height, dash);
+            break;
+        }
+        case DrawList::Segments:
+            for(const XSegment& s: b.segs) line(px, s.x1, s.y1, s.x2, s.y2);
+            break;
+        }
+    }
+}
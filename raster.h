@@ -0,0 +1,47 @@
+#pragma once
+
+#include "draw_list.h"
+#include <cstdint>
+#include <vector>
+
+// Client-side 32-bit framebuffer that draws a DrawList's shapes the way the
+// X server draws the same requests: filled rectangles cover [x, x+w) and
+// [y, y+h), rectangle outlines and segments are thin lines that include
+// both end points, and dashed outlines are counted pixel by pixel along
+// the rectangle's path starting at its top-left corner. draw() leaves text
+// to the caller (the X backend draws it with the server's font); text()
+// uses the built-in bitmap font instead. Pixels are written as given, so
+// they must already be in the target's 32-bit format.
+class Raster {
+public:
+    // own storage, or draw into caller memory (e.g. a shared memory image)
+    void resize(int w, int h);
+    void attach(std::uint32_t* data, int w, int h, int stride_pixels);
+
+    // limit drawing to a rectangle, e.g. to repaint only damaged areas;
+    // attach() resets it to the whole framebuffer
+    void clip(int x,int y,int w,int h);
+    void unclip() { clip(0, 0, width, height); }
+
+    void fill(std::uint32_t px, int x,int y,int w,int h);
+    void outline(std::uint32_t px, int x,int y,int w,int h, int dash = 0);
+    void line(std::uint32_t px, int x1,int y1,int x2,int y2);
+    void text(std::uint32_t px, int x,int y, const char* s, int len);
+
+    // shapes of the list, in painter's order
+    void draw(const DrawList& dl);
+    // ... and its text, on top
+    void draw_text(const DrawList& dl);
+
+    std::uint32_t* pixels = nullptr;
+    int width = 0, height = 0, stride = 0;
+
+private:
+    void plot(std::uint32_t px, int x,int y){
+        if(x >= clip_x0 && y >= clip_y0 && x < clip_x1 && y < clip_y1) pixels[y*stride + x] = px;
+    }
+
+    int clip_x0 = 0, clip_y0 = 0, clip_x1 = 0, clip_y1 = 0;
+
+    std::vector<std::uint32_t> storage;
+};
@@ -2,269 +2,378 @@
 // Created by roman on 2025-11-22.
 //
 #include "render.h"
+#include "trace.h"
 #include <cstring>
 #include <algorithm>
 #include <cstdio>
-#include <unordered_map>
+#include <cstdlib>
 #include <chrono>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 
-unsigned long rgb(unsigned char r,unsigned char g,unsigned char b){
-    return (r<<16)|(g<<8)|b;
+// XShmAttach fails asynchronously (e.g. on a remote display), so the
+// attach is wrapped in a temporary error handler
+static bool attach_failed = false;
+static int attach_error(Display*, XErrorEvent*){
+    attach_failed = true;
+    return 0;
 }
 
-static unsigned long alloc_color(Display* dpy, unsigned long rgb24){
-    static std::unordered_map<unsigned long, unsigned long> cache;
-    auto it = cache.find(rgb24);
-    if(it != cache.end()) return it->second;
+// scale an 8-bit channel into a TrueColor visual mask
+static unsigned long channel(unsigned long v8, unsigned long mask){
+    if(!mask) return 0;
+    int shift = 0;
+    while(!((mask >> shift) & 1)) ++shift;
+    unsigned long max = mask >> shift;
+    return ((v8 * max + 127) / 255) << shift;
+}
+
+// request sizes in the core protocol encoding, for frame_bytes
+static unsigned long list_bytes(std::size_t n){ return 12 + 8*n; }   // Poly*, SetClipRectangles
+static unsigned long text_bytes(int len){ return 16 + ((len + 2 + 3) & ~3u); }  // PolyText8
+constexpr unsigned long CHANGE_GC_BYTES = 16;      // one value: foreground, clip mask
+constexpr unsigned long COPY_AREA_BYTES = 28;
+constexpr unsigned long SHM_PUT_IMAGE_BYTES = 40;
+static unsigned long put_image_bytes(int w, int h){ return 24 + 4ul*w*h; }
+
+// core-protocol submission of a draw list (the software backends replay it instead)
+void DrawList::submit(Display* dpy, Drawable drw, GC solid, GC ghost, GC flash){
+    GC gcs[] = {solid, ghost, flash};
+    unsigned long fg[] = {0, 0, 0};
+    bool have_fg[] = {false, false, false};
+    auto set_fg = [&](Style style, unsigned long pixel){
+        if(have_fg[style] && fg[style] == pixel) return;
+        XSetForeground(dpy, gcs[style], pixel);
+        sent_bytes += CHANGE_GC_BYTES;
+        fg[style] = pixel;
+        have_fg[style] = true;
+    };
+
+    for(std::size_t i=0;i<used;++i){
+        Batch& b = batches[i];
+        std::size_t n = b.kind == Segments ? b.segs.size() : b.rects.size();
+        if(!n) continue;   // emptied by restrict_to
+        GC gc = gcs[b.style];
+        set_fg(b.style, b.pixel);
+        sent_bytes += list_bytes(n);
+        switch(b.kind){
+        case Fill:
+            XFillRectangles(dpy, drw, gc, b.rects.data(), static_cast<int>(b.rects.size()));
+            break;
+        case Outline:
+            XDrawRectangles(dpy, drw, gc, b.rects.data(), static_cast<int>(b.rects.size()));
+            break;
+        case Segments:
+            XDrawSegments(dpy, drw, gc, b.segs.data(), static_cast<int>(b.segs.size()));
+            break;
+        }
+    }
+    submit_text(dpy, drw, solid);
+}
+
+void DrawList::submit_text(Display* dpy, Drawable drw, GC solid){
+    // text never overlaps other text, so group it by color
+    std::sort(texts.begin(), texts.end(),
+              [](const Text& a, const Text& b){ return a.pixel < b.pixel; });
+    bool have_fg = false;
+    unsigned long fg = 0;
+    for(const Text& t: texts){
+        if(!have_fg || fg != t.pixel){
+            XSetForeground(dpy, solid, t.pixel);
+            fg = t.pixel;
+            have_fg = true;
+            sent_bytes += CHANGE_GC_BYTES;
+        }
+        XDrawString(dpy, drw, solid, t.x, t.y, t.s, t.len);
+        sent_bytes += text_bytes(t.len);
+    }
+}
+
+unsigned long RenderContext::pixel(unsigned long rgb24){
+    unsigned long r = (rgb24 >> 16) & 0xff, g = (rgb24 >> 8) & 0xff, b = rgb24 & 0xff;
+    if(true_color)
+        return channel(r, visual->red_mask) | channel(g, visual->green_mask) | channel(b, visual->blue_mask);
 
     XColor xc{};
-    xc.red   = ((rgb24 >> 16) & 0xff) * 257;
-    xc.green = ((rgb24 >> 8)  & 0xff) * 257;
-    xc.blue  = ((rgb24)       & 0xff) * 257;
-    Colormap cmap = DefaultColormap(dpy, DefaultScreen(dpy));
-    if(XAllocColor(dpy, cmap, &xc)){
-        cache[rgb24] = xc.pixel;
+    xc.red   = r * 257;
+    xc.green = g * 257;
+    xc.blue  = b * 257;
+    if(XAllocColor(dpy, DefaultColormap(dpy, DefaultScreen(dpy)), &xc))
         return xc.pixel;
-    }
-    cache[rgb24] = rgb24;
     return rgb24;
 }
 
-static void draw_cell(Display* dpy, Drawable drw, GC gc,
-                      int x,int y,unsigned long color){
-    XSetForeground(dpy, gc, color);
-    int pxp = MARGIN + x*TILE;
-    int pyp = MARGIN + y*TILE;
-    XFillRectangle(dpy, drw, gc, pxp, pyp, TILE-1, TILE-1);
-}
+void RenderContext::init(Display* d, Window w, int width_, int height_, const Game& game,
+                         bool software_){
+    dpy = d;
+    win = w;
+    int screen = DefaultScreen(dpy);
+    visual = DefaultVisual(dpy, screen);
+    true_color = visual->c_class == TrueColor;
+    software = software_ && true_color;
+    shm = software && XShmQueryExtension(dpy);
+    if(shm) shm_completion = XShmGetEventBase(dpy) + ShmCompletion;
+
+    palette = resolve_palette(game, [this](unsigned long rgb24){ return pixel(rgb24); });
 
-static void draw_piece_at(Display* dpy, Drawable drw, GC gc,
-                          int ox,int oy,int tile,
-                          unsigned long color,
-                          const Piece& p,int rot){
-    for(auto v: p.rot[rot]){
-        XSetForeground(dpy, gc, color);
-        XFillRectangle(dpy, drw, gc,
-                       ox + v.x*tile,
-                       oy + v.y*tile,
-                       tile-1, tile-1);
+    gc = XCreateGC(dpy, win, 0, nullptr);
+    // text damage is measured with the glyph box of the GC's font
+    if(XFontStruct* fs = XQueryFont(dpy, XGContextFromGC(gc))){
+        text_metrics = {fs->max_bounds.ascent, fs->max_bounds.descent, fs->max_bounds.width};
+        XFreeFontInfo(nullptr, fs, 1);
     }
-}
 
-static void draw_button(Display* dpy, Drawable drw, GC gc,
-                        const Rect& r, const char* label, bool active){
-    unsigned long fill = active ? rgb(80,80,120) : rgb(60,60,60);
-    XSetForeground(dpy, gc, fill);
-    XFillRectangle(dpy, drw, gc, r.x, r.y, r.w, r.h);
-    XSetForeground(dpy, gc, rgb(200,200,200));
-    XDrawRectangle(dpy, drw, gc, r.x, r.y, r.w, r.h);
-    int tx = r.x + 6;
-    int ty = r.y + r.h/2 + 4;
-    XDrawString(dpy, drw, gc, tx, ty, label, std::strlen(label));
+    XGCValues v{};
+    v.line_width = 0;   // thin lines, so the software rasterizer matches them
+    v.line_style = LineOnOffDash;
+    v.cap_style = CapButt;
+    v.join_style = JoinMiter;
+    v.foreground = palette.ghost;
+    unsigned long mask = GCLineWidth | GCLineStyle | GCCapStyle | GCJoinStyle | GCForeground;
+    ghost_gc = XCreateGC(dpy, win, mask, &v);
+    char ghost_dashes[] = {GHOST_DASH, GHOST_DASH};
+    XSetDashes(dpy, ghost_gc, 0, ghost_dashes, 2);
+    flash_gc = XCreateGC(dpy, win, mask, &v);
+    char flash_dashes[] = {FLASH_DASH, FLASH_DASH};
+    XSetDashes(dpy, flash_gc, 0, flash_dashes, 2);
+
+    v.graphics_exposures = False;
+    copy_gc = XCreateGC(dpy, win, GCGraphicsExposures, &v);
+
+    damage = XCreateRegion();
+    resize(width_, height_);
 }
 
-static void draw_checkbox(Display* dpy, Drawable drw, GC gc,
-                          const Rect& r, const char* label, bool checked,
-                          unsigned long text_color){
-    unsigned long bg = rgb(50,50,50);
-    unsigned long border = rgb(90,90,90);
-    unsigned long tick = rgb(200,200,200);
-    XSetForeground(dpy, gc, bg);
-    XFillRectangle(dpy, drw, gc, r.x, r.y, r.w, r.h);
-    XSetForeground(dpy, gc, border);
-    XDrawRectangle(dpy, drw, gc, r.x, r.y, r.w, r.h);
+void RenderContext::release(){
+    if(!dpy) return;
+    destroy_image();
+    if(back) XFreePixmap(dpy, back);
+    if(damage) XDestroyRegion(damage);
+    XFreeGC(dpy, gc);
+    XFreeGC(dpy, ghost_gc);
+    XFreeGC(dpy, flash_gc);
+    XFreeGC(dpy, copy_gc);
+    back = 0;
+    damage = nullptr;
+    clipped = false;
+    dpy = nullptr;
+}
 
-    int box = 16;
-    int bx = r.x + 6;
-    int by = r.y + (r.h - box)/2;
-    XDrawRectangle(dpy, drw, gc, bx, by, box, box);
-    if(checked){
-        // simple X mark
-        XSetForeground(dpy, gc, tick);
-        XDrawLine(dpy, drw, gc, bx+3, by+3, bx+box-3, by+box-3);
-        XDrawLine(dpy, drw, gc, bx+3, by+box-3, bx+box-3, by+3);
+void RenderContext::resize(int w, int h){
+    if(back && w == width && h == height) return;
+    if(back) XFreePixmap(dpy, back);
+    width = w;
+    height = h;
+    int depth = DefaultDepth(dpy, DefaultScreen(dpy));
+    back = XCreatePixmap(dpy, win, width, height, depth);
+    // anything outside the board and panel keeps the window background
+    XSetForeground(dpy, gc, WhitePixel(dpy, DefaultScreen(dpy)));
+    XFillRectangle(dpy, back, gc, 0, 0, width, height);
+    drawn = false;
+    if(software){
+        destroy_image();
+        create_image();
     }
-    XSetForeground(dpy, gc, text_color);
-    int tx = bx + box + 6;
-    int ty = r.y + r.h/2 + 4;
-    XDrawString(dpy, drw, gc, tx, ty, label, std::strlen(label));
 }
 
-void render(Display* dpy,
-            Window win,
-            GC gc,
-            const Game& game,
-            const Rect& pause_btn,
-            const Rect& exit_btn,
-            const Rect& ghost_btn)
-{
-    const int board_w = Game::W*TILE + 2*MARGIN;
-    const int board_h = Game::H*TILE + 2*MARGIN;
-    const int total_w = board_w + PANEL_W;
+void RenderContext::create_image(){
     int depth = DefaultDepth(dpy, DefaultScreen(dpy));
-    Pixmap back = XCreatePixmap(dpy, win, total_w, board_h, depth); // simple double buffer to avoid flicker
+    if(shm){
+        image = XShmCreateImage(dpy, visual, depth, ZPixmap, nullptr, &shm_info, width, height);
+        if(image){
+            shm_info.shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+            void* addr = shm_info.shmid >= 0 ? shmat(shm_info.shmid, nullptr, 0) : reinterpret_cast<void*>(-1);
+            if(addr != reinterpret_cast<void*>(-1)){
+                shm_info.shmaddr = image->data = static_cast<char*>(addr);
+                shm_info.readOnly = False;
+                attach_failed = false;
+                XErrorHandler old = XSetErrorHandler(attach_error);
+                XShmAttach(dpy, &shm_info);
+                XSync(dpy, False);
+                XSetErrorHandler(old);
+                if(attach_failed) shmdt(addr);
+            } else {
+                attach_failed = true;
+            }
+            // the segment goes away once both sides have detached
+            if(shm_info.shmid >= 0) shmctl(shm_info.shmid, IPC_RMID, nullptr);
+            if(attach_failed){
+                image->data = nullptr;
+                XDestroyImage(image);
+                image = nullptr;
+            }
+        }
+        if(!image){
+            std::fprintf(stderr, "MIT-SHM unavailable, falling back to XPutImage\n");
+            shm = false;
+        }
+    }
+    if(!image){
+        image = XCreateImage(dpy, visual, depth, ZPixmap, 0, nullptr, width, height, 32, 0);
+        if(image) image->data = static_cast<char*>(std::calloc(image->bytes_per_line, image->height));
+    }
+    if(!image || image->bits_per_pixel != 32){
+        std::fprintf(stderr, "software renderer needs 32-bit pixels, using core drawing\n");
+        destroy_image();
+        software = false;
+        return;
+    }
+    raster.attach(reinterpret_cast<std::uint32_t*>(image->data), width, height,
+                  image->bytes_per_line / 4);
+}
 
-    unsigned long col_bg    = alloc_color(dpy, BG);
-    unsigned long col_grid  = alloc_color(dpy, GRID);
-    unsigned long col_panel = alloc_color(dpy, PANEL_BG);
-    unsigned long col_text  = alloc_color(dpy, rgb(180,180,180));
-    unsigned long col_btn   = alloc_color(dpy, rgb(200,200,200));
+void RenderContext::destroy_image(){
+    if(!image) return;
+    wait_put();
+    if(shm){
+        XShmDetach(dpy, &shm_info);
+        XSync(dpy, False);
+        shmdt(shm_info.shmaddr);
+        image->data = nullptr;
+    }
+    XDestroyImage(image);
+    image = nullptr;
+}
 
-    XSetForeground(dpy, gc, col_bg);
-    XFillRectangle(dpy, back, gc, 0, 0, board_w, board_h);
+static Bool is_completion(Display*, XEvent* e, XPointer type){
+    return e->type == *reinterpret_cast<int*>(type);
+}
 
-    // grid
-    XSetForeground(dpy, gc, col_grid);
-    for(int r=0;r<=Game::H;++r)
-        XDrawLine(dpy, back, gc,
-                  MARGIN, MARGIN + r*TILE,
-                  MARGIN + Game::W*TILE, MARGIN + r*TILE);
-    for(int c=0;c<=Game::W;++c)
-        XDrawLine(dpy, back, gc,
-                  MARGIN + c*TILE, MARGIN,
-                  MARGIN + c*TILE, MARGIN + Game::H*TILE);
+void RenderContext::wait_put(){
+    if(!put_pending) return;
+    XEvent e;
+    XIfEvent(dpy, &e, is_completion, reinterpret_cast<XPointer>(&shm_completion));
+    put_pending = false;
+}
 
-    // field
-    for(int r=0;r<Game::H;++r)
-        for(int c=0;c<Game::W;++c)
-            if(game.field[r][c])
-                draw_cell(dpy, back, gc, c, r,
-                          alloc_color(dpy, game.pieces[game.field[r][c]-1].color));
+bool RenderContext::event(const XEvent& e){
+    if(!shm || e.type != shm_completion) return false;
+    put_pending = false;
+    return true;
+}
 
-    // ghost piece
-    if(!game.over && game.show_ghost){
-        int gy = game.py;
-        while(!game.collides(game.px, gy+1, game.pr))
-            ++gy;
-        if(gy > game.py){
-            unsigned long ghost_px = alloc_color(dpy, rgb(80,80,80));
-            char dashes[] = {4,4};
-            XSetLineAttributes(dpy, gc, 1, LineOnOffDash, CapButt, JoinMiter);
-            XSetDashes(dpy, gc, 0, dashes, 2);
-            XSetForeground(dpy, gc, ghost_px);
-            for(auto v: game.pieces[game.cur].rot[game.pr]){
-                int gx = game.px + v.x;
-                int gy_cell = gy + v.y;
-                int pxp = MARGIN + gx*TILE;
-                int pyp = MARGIN + gy_cell*TILE;
-                XDrawRectangle(dpy, back, gc, pxp, pyp, TILE-2, TILE-2);
-            }
-            // restore solid lines
-            XSetLineAttributes(dpy, gc, 0, LineSolid, CapButt, JoinMiter);
+void RenderContext::present_software(const std::vector<XRectangle>* area){
+    wait_put();   // the server may still be reading the last frame
+    if(!area){
+        raster.draw(list);
+        area = &dirty;
+        dirty.assign(1, XRectangle{0, 0, static_cast<unsigned short>(layout.width),
+                                   static_cast<unsigned short>(layout.height)});
+    } else {
+        for(const XRectangle& r: *area){
+            raster.clip(r.x, r.y, r.width, r.height);
+            raster.draw(list);
         }
+        raster.unclip();
     }
-
-    // flash rows if any were just cleared
-    auto now = std::chrono::steady_clock::now();
-    bool flash_active = game.flashing && now < game.flash_until;
-    bool flash_on = flash_active &&
-        ((std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() / 80) % 2 == 0);
-    if(flash_on){
-        char dashes[] = {3,3};
-        XSetLineAttributes(dpy, gc, 1, LineOnOffDash, CapButt, JoinMiter);
-        XSetDashes(dpy, gc, 0, dashes, 2);
-        for(const auto& cr : game.cleared_rows){
-            int base_y = MARGIN + cr.row * TILE;
-            for(int c=0;c<Game::W;++c){
-                if(cr.data[c] == 0) continue;
-                unsigned long col = alloc_color(dpy, game.pieces[cr.data[c]-1].color);
-                XSetForeground(dpy, gc, col);
-                int x = MARGIN + c * TILE;
-                XDrawRectangle(dpy, back, gc, x, base_y, TILE-2, TILE-2);
-            }
+    // the server executes puts in order, so one completion covers them all
+    for(std::size_t i=0;i<area->size();++i){
+        const XRectangle& r = (*area)[i];
+        if(shm){
+            bool last = i+1 == area->size();
+            XShmPutImage(dpy, back, gc, image, r.x, r.y, r.x, r.y, r.width, r.height, last);
+            frame_bytes += SHM_PUT_IMAGE_BYTES;
+        } else {
+            XPutImage(dpy, back, gc, image, r.x, r.y, r.x, r.y, r.width, r.height);
+            frame_bytes += put_image_bytes(r.width, r.height);
         }
-        XSetLineAttributes(dpy, gc, 0, LineSolid, CapButt, JoinMiter);
     }
+    put_pending = shm && !area->empty();
+    list.submit_text(dpy, back, gc);
+}
 
-    // active piece
-    if(!game.over){
-        for(auto v: game.pieces[game.cur].rot[game.pr])
-            draw_cell(dpy, back, gc,
-                      game.px + v.x,
-                      game.py + v.y,
-                      alloc_color(dpy, game.pieces[game.cur].color));
+void RenderContext::clip_to(const std::vector<XRectangle>* area){
+    if(!area && !clipped) return;
+    // the software backend draws only text, with the solid GC
+    GC gcs[] = {gc, ghost_gc, flash_gc};
+    int count = software ? 1 : 3;
+    for(int i=0;i<count;++i){
+        if(area){
+            XSetClipRectangles(dpy, gcs[i], 0, 0, const_cast<XRectangle*>(area->data()),
+                               static_cast<int>(area->size()), Unsorted);
+            frame_bytes += list_bytes(area->size());
+        } else {
+            XSetClipMask(dpy, gcs[i], None);
+            frame_bytes += CHANGE_GC_BYTES;
+        }
     }
+    clipped = area != nullptr;
+}
 
-    // side panel
-    int panel_x = board_w;
-    XSetForeground(dpy, gc, col_panel);
-    XFillRectangle(dpy, back, gc, panel_x, 0, PANEL_W, board_h);
-
-    XSetForeground(dpy, gc, col_text);
-    const char* next_label = "Next:";
-    XDrawString(dpy, back, gc,
-                panel_x + MARGIN, MARGIN + 12,
-                next_label, std::strlen(next_label));
-
-    // preview box 4x4
-    int box_x = panel_x + MARGIN;
-    int box_y = MARGIN + 18;
-    int preview_tile = TILE;
-    XSetForeground(dpy, gc, GRID);
-    XDrawRectangle(dpy, back, gc,
-                   box_x-2, box_y-2,
-                   preview_tile*4+3, preview_tile*4+3);
+bool RenderContext::expose(const XExposeEvent& e){
+    XRectangle r{static_cast<short>(e.x), static_cast<short>(e.y),
+                 static_cast<unsigned short>(e.width), static_cast<unsigned short>(e.height)};
+    XUnionRectWithRegion(&r, damage, damage);
+    if(e.count > 0) return true;
 
-    // center preview piece
-    int minx=10, maxx=-10, miny=10, maxy=-10;
-    for(auto v: game.pieces[game.nxt].rot[0]){
-        minx = std::min(minx, v.x);
-        maxx = std::max(maxx, v.x);
-        miny = std::min(miny, v.y);
-        maxy = std::max(maxy, v.y);
+    bool ok = drawn;
+    if(ok){
+        // one clipped copy of the bounding box covers the whole series
+        XRectangle box;
+        XClipBox(damage, &box);
+        XSetRegion(dpy, copy_gc, damage);
+        XCopyArea(dpy, back, win, copy_gc, box.x, box.y, box.width, box.height, box.x, box.y);
+        XSetClipMask(dpy, copy_gc, None);
+        XFlush(dpy);
     }
-    int pw = (maxx-minx+1)*preview_tile;
-    int ph = (maxy-miny+1)*preview_tile;
-    int ox = box_x + (preview_tile*4 - pw)/2 - minx*preview_tile;
-    int oy = box_y + (preview_tile*4 - ph)/2 - miny*preview_tile;
-    draw_piece_at(dpy, back, gc, ox, oy, preview_tile,
-                  game.pieces[game.nxt].color,
-                  game.pieces[game.nxt], 0);
-
-    // score / level text
-    char buf[64];
-    int text_y = box_y + preview_tile*4 + 24;
-    std::snprintf(buf, sizeof(buf), "Score: %d", game.score);
-    XDrawString(dpy, back, gc,
-                panel_x + MARGIN, text_y,
-                buf, std::strlen(buf));
-    text_y += 16;
-    std::snprintf(buf, sizeof(buf), "Level: %d", game.level);
-    XDrawString(dpy, back, gc,
-                panel_x + MARGIN, text_y,
-                buf, std::strlen(buf));
+    XDestroyRegion(damage);
+    damage = XCreateRegion();
+    return ok;
+}
 
-// buttons (placed below score block, see main.cpp)
-    draw_button(dpy, back, gc, pause_btn,
-                game.paused ? "Resume" : "Pause",
-                game.paused);
-    draw_button(dpy, back, gc, exit_btn, "Exit", false);
+void RenderContext::render(const Game& game)
+{
+    TRACE_SCOPE("render");
+    unsigned long first_request = XNextRequest(dpy);
+    frame_bytes = 0;
+    TRACE_PHASES(phase, "damage");
+    FrameState state = FrameState::capture(game, text_metrics, &status);
+    bool partial = incremental && drawn;
+    if(partial){
+        dirty.clear();
+        frame_damage(shown, state, layout, text_metrics, dirty);
+        if(dirty.empty()){
+            // the window already shows this frame
+            frame_requests = 0;
+            ++frames_skipped;
+            return;
+        }
+    }
+    shown = state;
 
-    // options separator + ghost toggle under buttons
-    int sep_y = ghost_btn.y - 30;
-    XSetForeground(dpy, gc, col_grid);
-    XDrawLine(dpy, back, gc, panel_x + MARGIN, sep_y, panel_x + PANEL_W - MARGIN, sep_y);
-    XSetForeground(dpy, gc, col_text);
-    const char* opt = "Options";
-    XDrawString(dpy, back, gc, panel_x + MARGIN, sep_y + 16, opt, std::strlen(opt));
-    draw_checkbox(dpy, back, gc, ghost_btn, "Ghost", game.show_ghost, col_btn);
+    TRACE_NEXT(phase, "build");
+    build_frame(list, palette, layout, game, &status);
+    if(partial) list.restrict_to(dirty, text_metrics);
+    clip_to(partial ? &dirty : nullptr);
 
-    if(game.over){
-        const char* msg = "Stack full! R=restart, Esc=exit";
-        XSetForeground(dpy, gc, alloc_color(dpy, rgb(255,255,255)));
-        XDrawString(dpy, back, gc,
-                    MARGIN, 20,
-                    msg, std::strlen(msg));
-    } else if(game.paused){
-        const char* msg = "Paused (P or button to resume)";
-        XSetForeground(dpy, gc, alloc_color(dpy, rgb(220,220,220)));
-        XDrawString(dpy, back, gc,
-                    MARGIN, 20,
-                    msg, std::strlen(msg));
+    TRACE_NEXT(phase, "submit");
+    if(software){
+        present_software(partial ? &dirty : nullptr);
+    } else {
+        list.submit(dpy, back, gc, ghost_gc, flash_gc);
     }
+    frame_bytes += list.sent_bytes;
 
-    // blit back buffer
-    XCopyArea(dpy, back, win, gc, 0, 0, total_w, board_h, 0, 0);
-    XFreePixmap(dpy, back);
+    // blit back buffer, only the damage of a partial frame
+    TRACE_NEXT(phase, "blit");
+    if(partial){
+        XRectangle box = dirty[0];
+        int x1 = box.x + box.width, y1 = box.y + box.height;
+        for(const XRectangle& r: dirty){
+            box.x = std::min(box.x, r.x);
+            box.y = std::min(box.y, r.y);
+            x1 = std::max(x1, r.x + r.width);
+            y1 = std::max(y1, r.y + r.height);
+        }
+        XSetClipRectangles(dpy, copy_gc, 0, 0, dirty.data(), static_cast<int>(dirty.size()), Unsorted);
+        XCopyArea(dpy, back, win, copy_gc, box.x, box.y, x1 - box.x, y1 - box.y, box.x, box.y);
+        XSetClipMask(dpy, copy_gc, None);
+        frame_bytes += list_bytes(dirty.size()) + COPY_AREA_BYTES + CHANGE_GC_BYTES;
+    } else {
+        XCopyArea(dpy, back, win, copy_gc, 0, 0, layout.width, layout.height, 0, 0);
+        frame_bytes += COPY_AREA_BYTES;
+    }
+    drawn = true;
+    frame_requests = XNextRequest(dpy) - first_request;
     XFlush(dpy);
 }
@@ -1,26 +1,93 @@
 #pragma once
 
-#include "game.h"
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include "raster.h"
+#include "renderer.h"
 
-struct Rect { int x,y,w,h; };
+// The X11 Renderer: per-window rendering state, created once. Frames are drawn into a
+// persistent back buffer that is only recreated when the window size
+// changes; exposures are repaired by copying from it instead of redrawing.
+// Colors are resolved up front (by mask shifts on TrueColor visuals, one
+// XAllocColor each otherwise) and every line style has its own GC, so a
+// frame makes no colormap calls and never reconfigures a GC's lines.
+//
+// With `software` the shapes are rasterized client-side into an XImage
+// and sent as a single XShmPutImage (plain XPutImage when the display has
+// no MIT-SHM); only the few text strings are still core requests.
+//
+// The state behind the last presented frame is kept as a FrameState, and
+// each render() repaints and blits only the cells and panel regions whose
+// state changed (clipped to them); a frame that changes nothing sends no
+// requests at all.
+struct RenderContext : Renderer {
+    Display* dpy = nullptr;
+    Window win = 0;
+    GC gc = nullptr;             // solid fills, lines and text
+    GC ghost_gc = nullptr;       // dashed ghost outlines
+    GC flash_gc = nullptr;       // dashed line-clear flash outlines
+    GC copy_gc = nullptr;        // back buffer to window, clipped on Expose
+    Palette palette{};
+    Pixmap back = 0;
+    int width = 0, height = 0;
+    bool drawn = false;          // back holds a complete frame
+    DrawList list;
+    unsigned long frame_requests = 0;  // X requests issued by the last render
+    unsigned long frame_bytes = 0;     // ... and their size in protocol bytes
+    long long frames_skipped = 0;      // renders that had nothing to change
+    bool incremental = true;           // false: every render repaints the whole window
+    PanelStatus status;                // drawn at the bottom of the side panel
+    bool software = false;       // software rasterizer backend in use
+    bool shm = false;            // ... blitting through MIT-SHM
 
-// rendering-specific constants
-constexpr int TILE   = 24;
-constexpr int MARGIN = 4;
-constexpr int PANEL_W = 6*TILE + 2*MARGIN;
+    Layout layout = Layout::standard();
 
-constexpr unsigned long BG       = 0x1c1c1c;
-constexpr unsigned long GRID     = 0x303030;
-constexpr unsigned long PANEL_BG = 0x111111;
+    // piece colors are taken from game.pieces; `software` is ignored
+    // (core drawing is used) unless the visual is TrueColor with 32-bit pixels
+    void init(Display* d, Window w, int width, int height, const Game& game,
+              bool software = false);
+    void release();
 
-unsigned long rgb(unsigned char r,unsigned char g,unsigned char b);
+    // ConfigureNotify: new back buffer if (and only if) the size changed
+    void resize(int w, int h);
 
-// render a single frame
-void render(Display* dpy,
-            Window win,
-            GC gc,
-            const Game& game,
-            const Rect& pause_btn,
-            const Rect& exit_btn,
-            const Rect& ghost_btn);
+    // Expose: collect the rectangle; on the last one of a series (count 0)
+    // copy all of them from the back buffer. Returns false if there is no
+    // frame to copy from yet and the caller has to render one.
+    bool expose(const XExposeEvent& e);
+
+    // consumes the backend's own events (SHM completions); true if it did
+    bool event(const XEvent& e);
+
+    unsigned long pixel(unsigned long rgb24);
+
+    // render a single frame into the back buffer and present it
+    void render(const Game& game) override;
+
+private:
+    // software backend: rasterize the shapes of `list` (only inside `area`
+    // if given), put them on the back buffer, then draw the text with core
+    // requests
+    void present_software(const std::vector<XRectangle>* area);
+    // clip the drawing GCs to `area`, or unclip them for nullptr
+    void clip_to(const std::vector<XRectangle>* area);
+    void create_image();
+    void destroy_image();
+    void wait_put();
+
+    Region damage = nullptr;     // exposed area pending copy
+    Visual* visual = nullptr;
+    bool true_color = false;
+
+    XImage* image = nullptr;
+    XShmSegmentInfo shm_info{};
+    int shm_completion = -1;     // event type of ShmCompletion
+    bool put_pending = false;    // server may still be reading image
+    Raster raster;
+
+    TextMetrics text_metrics{13, 4, 9};  // server font; replaced in init()
+    FrameState shown{};                  // what the back buffer holds
+    std::vector<XRectangle> dirty;       // damage of the frame being drawn
+    bool clipped = false;                // drawing GCs carry a clip list
+};
@@ -0,0 +1,289 @@
+#include "renderer.h"
+#include "trace.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+Layout Layout::standard(){
+    Layout l;
+    int board_w = Game::W*TILE + 2*MARGIN;
+    int board_h = Game::H*TILE + 2*MARGIN;
+    l.width  = board_w + PANEL_W;
+    l.height = board_h;
+
+    int btn_w = PANEL_W - 2*MARGIN;
+    int btn_h = 28;
+    int btn_x = board_w + MARGIN;
+    l.preview = {board_w + MARGIN, MARGIN + 18, TILE*4, TILE*4};
+    l.score_y = l.preview.y + l.preview.h + 24;
+    l.level_y = l.score_y + 16;
+    int preview_bottom = l.preview.y + l.preview.h;
+    int text_block_bottom = preview_bottom + 60;
+    int btn_y1 = text_block_bottom + 20;
+    l.pause_btn = {btn_x, btn_y1, btn_w, btn_h};
+    l.exit_btn  = {btn_x, btn_y1 + btn_h + 8, btn_w, btn_h};
+    int ghost_h = 22;
+    int ghost_y = l.exit_btn.y + l.exit_btn.h + 73;
+    l.ghost_btn = {btn_x, ghost_y, btn_w, ghost_h};
+    l.status_y = ghost_y + ghost_h + 30;
+    return l;
+}
+
+// row the ghost outline sits on, or -1 when no ghost is shown
+static int ghost_row(const Game& game){
+    if(game.over || !game.show_ghost) return -1;
+    int gy = game.drop_row();
+    return gy > game.py ? gy : -1;
+}
+
+// the line-clear flash blinks in 80 ms phases of game.now
+static bool flash_on(const Game& game){
+    if(!game.flashing || game.now >= game.flash_until) return false;
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(game.now.time_since_epoch()).count();
+    return (ms / 80) % 2 == 0;
+}
+
+// message drawn over the top of the board, if any
+static constexpr int OVERLAY_X = MARGIN, OVERLAY_Y = 20;
+static const char* overlay_text(const Game& game){
+    if(game.over) return "Stack full! R=restart, Esc=exit";
+    if(game.paused) return "Paused (P or button to resume)";
+    return nullptr;
+}
+
+// frame and label of a button or checkbox; its face is filled a layer
+// earlier, so no face batch can land on top of another widget's frame
+static void draw_button(DrawList& dl, const Palette& pal,
+                        const Rect& r, const char* label){
+    dl.outline(pal.button_text, r.x, r.y, r.w, r.h);
+    dl.text(pal.button_text, r.x + 6, r.y + r.h/2 + 4, label);
+}
+
+static void draw_checkbox(DrawList& dl, const Palette& pal,
+                          const Rect& r, const char* label, bool checked){
+    unsigned long border = pal.checkbox_border;
+    unsigned long tick = pal.button_text;
+    unsigned long text_color = pal.button_text;
+    dl.outline(border, r.x, r.y, r.w, r.h);
+
+    int box = 16;
+    int bx = r.x + 6;
+    int by = r.y + (r.h - box)/2;
+    dl.outline(border, bx, by, box, box);
+    if(checked){
+        // simple X mark
+        dl.line(tick, bx+3, by+3, bx+box-3, by+box-3);
+        dl.line(tick, bx+3, by+box-3, bx+box-3, by+3);
+    }
+    dl.text(text_color, bx + box + 6, r.y + r.h/2 + 4, label);
+}
+
+
+void build_frame(DrawList& dl, const Palette& pal, const Layout& layout, const Game& game,
+                 const PanelStatus* status)
+{
+    const int board_w = Game::W*TILE + 2*MARGIN;
+    const int board_h = Game::H*TILE + 2*MARGIN;
+    int panel_x = board_w;
+
+    // layer: backgrounds
+    TRACE_PHASES(phase, "grid");
+    dl.clear();
+    dl.fill(pal.bg, 0, 0, board_w, board_h);
+    dl.fill(pal.panel, panel_x, 0, PANEL_W, board_h);
+
+    // layer: grid and panel frames
+    dl.layer();
+    for(int r=0;r<=Game::H;++r)
+        dl.line(pal.grid,
+                MARGIN, MARGIN + r*TILE,
+                MARGIN + Game::W*TILE, MARGIN + r*TILE);
+    for(int c=0;c<=Game::W;++c)
+        dl.line(pal.grid,
+                MARGIN + c*TILE, MARGIN,
+                MARGIN + c*TILE, MARGIN + Game::H*TILE);
+
+    // preview box 4x4
+    int box_x = layout.preview.x;
+    int box_y = layout.preview.y;
+    int preview_tile = layout.preview.w / 4;
+    dl.outline(pal.grid,
+               box_x-2, box_y-2,
+               preview_tile*4+3, preview_tile*4+3);
+
+    // options separator above the ghost toggle
+    int sep_y = layout.ghost_btn.y - 30;
+    dl.line(pal.grid, panel_x + MARGIN, sep_y, panel_x + PANEL_W - MARGIN, sep_y);
+
+    // layer: settled cells, preview piece, buttons
+    TRACE_NEXT(phase, "field");
+    dl.layer();
+    for(int r=0;r<Game::H;++r)
+        for(int c=0;c<Game::W;++c)
+            if(game.cells[r][c])
+                dl.fill(pal.piece[game.cells[r][c]-1],
+                        MARGIN + c*TILE, MARGIN + r*TILE, TILE-1, TILE-1);
+
+    // center preview piece (offsets precomputed per rotation)
+    const Shape& preview = game.pieces[game.nxt].rot[0];
+    int ox = box_x + preview.preview_x2*preview_tile/2;
+    int oy = box_y + preview.preview_y2*preview_tile/2;
+    unsigned long preview_px = pal.piece[game.nxt];
+    for(auto v: preview)
+        dl.fill(preview_px, ox + v.x*preview_tile, oy + v.y*preview_tile,
+                preview_tile-1, preview_tile-1);
+
+    // button faces (placed below score block, see Layout::standard)
+    auto face = [&](unsigned long px, const Rect& r){ dl.fill(px, r.x, r.y, r.w, r.h); };
+    face(game.paused ? pal.button_active : pal.button, layout.pause_btn);
+    face(pal.button, layout.exit_btn);
+    face(pal.checkbox, layout.ghost_btn);
+
+    // layer: button frames, ghost and flash outlines
+    dl.layer();
+    draw_button(dl, pal, layout.pause_btn, game.paused ? "Resume" : "Pause");
+    draw_button(dl, pal, layout.exit_btn, "Exit");
+    draw_checkbox(dl, pal, layout.ghost_btn, "Ghost", game.show_ghost);
+
+    TRACE_NEXT(phase, "ghost");
+    int gy = ghost_row(game);
+    if(gy >= 0){
+        for(auto v: game.pieces[game.cur].rot[game.pr])
+            dl.outline(pal.ghost,
+                       MARGIN + (game.px + v.x)*TILE,
+                       MARGIN + (gy + v.y)*TILE,
+                       TILE-2, TILE-2, DrawList::Ghost);
+    }
+
+    // flash rows if any were just cleared
+    TRACE_NEXT(phase, "flash");
+    if(flash_on(game)){
+        for(const auto& cr : game.cleared_rows){
+            int base_y = MARGIN + cr.row * TILE;
+            for(int c=0;c<Game::W;++c){
+                if(cr.data[c] == 0) continue;
+                dl.outline(pal.piece[cr.data[c]-1],
+                           MARGIN + c * TILE, base_y, TILE-2, TILE-2, DrawList::Flash);
+            }
+        }
+    }
+
+    // layer: active piece
+    TRACE_NEXT(phase, "piece");
+    dl.layer();
+    if(!game.over){
+        unsigned long piece_px = pal.piece[game.cur];
+        for(auto v: game.pieces[game.cur].rot[game.pr])
+            dl.fill(piece_px,
+                    MARGIN + (game.px + v.x)*TILE,
+                    MARGIN + (game.py + v.y)*TILE,
+                    TILE-1, TILE-1);
+    }
+
+    // text, drawn after all shapes
+    TRACE_NEXT(phase, "panel");
+    dl.text(pal.text, panel_x + MARGIN, MARGIN + 12, "Next:");
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "Score: %d", game.score);
+    dl.text(pal.text, panel_x + MARGIN, layout.score_y, buf);
+    std::snprintf(buf, sizeof(buf), "Level: %d", game.level);
+    dl.text(pal.text, panel_x + MARGIN, layout.level_y, buf);
+    dl.text(pal.text, panel_x + MARGIN, sep_y + 16, "Options");
+    if(status)
+        for(int i=0;i<PanelStatus::LINES;++i)
+            if(status->line[i][0])
+                dl.text(pal.text, panel_x + MARGIN, layout.status_y + i*16, status->line[i]);
+
+    if(const char* msg = overlay_text(game))
+        dl.text(game.over ? pal.game_over : pal.paused, OVERLAY_X, OVERLAY_Y, msg);
+}
+
+// cell keys: bits 0-3 fill (piece id + 1), bit 4 ghost outline, bits 5-8
+// flash outline (piece id + 1), bits 9-10 overlay message (1 over, 2 paused)
+FrameState FrameState::capture(const Game& game, const TextMetrics& tm,
+                               const PanelStatus* status){
+    FrameState st;
+    for(int r=0;r<Game::H;++r)
+        for(int c=0;c<Game::W;++c)
+            st.cell[r][c] = game.cells[r][c];
+
+    // the keys a piece's cells get, kept inside the board like its drawing
+    auto mark = [&](int y, std::uint16_t clear, std::uint16_t set){
+        for(auto v: game.pieces[game.cur].rot[game.pr]){
+            int r = y + v.y, c = game.px + v.x;
+            if(r >= 0 && r < Game::H && c >= 0 && c < Game::W)
+                st.cell[r][c] = static_cast<std::uint16_t>((st.cell[r][c] & ~clear) | set);
+        }
+    };
+
+    int gy = ghost_row(game);
+    if(gy >= 0) mark(gy, 0, 1u << 4);
+
+    if(flash_on(game))
+        for(const auto& cr : game.cleared_rows)
+            for(int c=0;c<Game::W;++c)
+                if(cr.data[c])
+                    st.cell[cr.row][c] |= static_cast<std::uint16_t>(cr.data[c] << 5);
+
+    if(!game.over) mark(game.py, 0xf, static_cast<std::uint16_t>(game.cur + 1));
+
+    if(const char* msg = overlay_text(game)){
+        std::uint16_t key = game.over ? 1u << 9 : 2u << 9;
+        int x0 = OVERLAY_X, x1 = OVERLAY_X + static_cast<int>(std::strlen(msg)) * tm.advance;
+        int y0 = OVERLAY_Y - tm.ascent, y1 = OVERLAY_Y + tm.descent;
+        for(int r=0;r<Game::H;++r){
+            int ty = MARGIN + r*TILE;
+            if(ty >= y1 || ty + TILE <= y0) continue;
+            for(int c=0;c<Game::W;++c){
+                int tx = MARGIN + c*TILE;
+                if(tx < x1 && tx + TILE > x0) st.cell[r][c] |= key;
+            }
+        }
+    }
+
+    st.nxt = game.nxt;
+    st.score = game.score;
+    st.level = game.level;
+    st.paused = game.paused;
+    st.show_ghost = game.show_ghost;
+    st.status = status ? *status : PanelStatus{};
+    return st;
+}
+
+static XRectangle xrect(int x,int y,int w,int h){
+    return XRectangle{static_cast<short>(x), static_cast<short>(y),
+                      static_cast<unsigned short>(w), static_cast<unsigned short>(h)};
+}
+
+void frame_damage(const FrameState& a, const FrameState& b, const Layout& layout,
+                  const TextMetrics& tm, std::vector<XRectangle>& out){
+    for(int r=0;r<Game::H;++r){
+        int c = 0;
+        while(c < Game::W){
+            if(a.cell[r][c] == b.cell[r][c]){ ++c; continue; }
+            int start = c;
+            while(c < Game::W && a.cell[r][c] != b.cell[r][c]) ++c;
+            out.push_back(xrect(MARGIN + start*TILE, MARGIN + r*TILE, (c - start)*TILE, TILE));
+        }
+    }
+
+    // panel: outlines reach one pixel past a button's size
+    const Rect& p = layout.preview;
+    int line_w = PANEL_W - 2*MARGIN;
+    if(a.nxt != b.nxt) out.push_back(xrect(p.x, p.y, p.w, p.h));
+    if(a.score != b.score)
+        out.push_back(xrect(p.x, layout.score_y - tm.ascent, line_w, tm.ascent + tm.descent));
+    if(a.level != b.level)
+        out.push_back(xrect(p.x, layout.level_y - tm.ascent, line_w, tm.ascent + tm.descent));
+    if(a.paused != b.paused){
+        const Rect& r = layout.pause_btn;
+        out.push_back(xrect(r.x, r.y, r.w + 1, r.h + 1));
+    }
+    if(a.show_ghost != b.show_ghost){
+        const Rect& r = layout.ghost_btn;
+        out.push_back(xrect(r.x, r.y, r.w + 1, r.h + 1));
+    }
+    for(int i=0;i<PanelStatus::LINES;++i)
+        if(std::strncmp(a.status.line[i], b.status.line[i], PanelStatus::LEN))
+            out.push_back(xrect(p.x, layout.status_y + i*16 - tm.ascent, line_w, tm.ascent + tm.descent));
+}
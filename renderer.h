@@ -0,0 +1,96 @@
+#pragma once
+
+#include "draw_list.h"
+#include "game.h"
+
+struct Rect { int x,y,w,h; };
+
+// rendering-specific constants
+constexpr int TILE   = 24;
+constexpr int MARGIN = 4;
+constexpr int PANEL_W = 6*TILE + 2*MARGIN;
+
+constexpr unsigned long BG       = 0x1c1c1c;
+constexpr unsigned long GRID     = 0x303030;
+constexpr unsigned long PANEL_BG = 0x111111;
+
+// Every color the renderer uses, resolved to pixel values once.
+struct Palette {
+    unsigned long bg, grid, panel, text, button_text;
+    unsigned long button, button_active, checkbox, checkbox_border;
+    unsigned long ghost, game_over, paused;
+    unsigned long piece[Game::PIECE_COUNT];
+};
+
+// fill a palette by mapping each 0xRRGGBB color through `pixel`
+template<class Fn>
+Palette resolve_palette(const Game& game, Fn&& pixel){
+    Palette p;
+    p.bg              = pixel(BG);
+    p.grid            = pixel(GRID);
+    p.panel           = pixel(PANEL_BG);
+    p.text            = pixel(rgb(180,180,180));
+    p.button_text     = pixel(rgb(200,200,200));
+    p.button          = pixel(rgb(60,60,60));
+    p.button_active   = pixel(rgb(80,80,120));
+    p.checkbox        = pixel(rgb(50,50,50));
+    p.checkbox_border = pixel(rgb(90,90,90));
+    p.ghost           = pixel(rgb(80,80,80));
+    p.game_over       = pixel(rgb(255,255,255));
+    p.paused          = pixel(rgb(220,220,220));
+    for(int i=0;i<Game::PIECE_COUNT;++i)
+        p.piece[i] = pixel(game.pieces[i].color);
+    return p;
+}
+
+// Window geometry: board on the left, side panel with preview, score,
+// buttons and options on the right.
+struct Layout {
+    int width = 0, height = 0;
+    Rect preview{};              // 4x4 tile box of the next piece
+    int score_y = 0, level_y = 0;  // text baselines in the panel
+    Rect pause_btn{}, exit_btn{}, ghost_btn{};
+    int status_y = 0;              // baseline of the first status line
+
+    static Layout standard();
+};
+
+// Extra readouts under the options in the side panel (e.g. input
+// latency); empty lines are not drawn.
+struct PanelStatus {
+    static constexpr int LINES = 2, LEN = 32;
+    char line[LINES][LEN]{};
+};
+
+// Compose one frame of `game` into `dl`. Everything time-dependent (the
+// line-clear flash) reads game.now, so the same state and time always
+// give the same frame.
+void build_frame(DrawList& dl, const Palette& pal, const Layout& layout, const Game& game,
+                 const PanelStatus* status = nullptr);
+
+// What a presented frame showed, reduced to the state each part of the
+// window depends on: one key per board cell (its fill, ghost and flash
+// outlines and any overlay text crossing it) plus the panel's values.
+// Comparing two of these gives the frame's damage without drawing it.
+struct FrameState {
+    std::uint16_t cell[Game::H][Game::W];
+    int nxt, score, level;
+    bool paused, show_ghost;
+    PanelStatus status;
+
+    static FrameState capture(const Game& game, const TextMetrics& tm,
+                              const PanelStatus* status = nullptr);
+};
+
+// Append the window rectangles that differ between `a` and `b` to `out`:
+// runs of changed cells (whole tiles with their top and left grid lines)
+// and the panel regions whose value changed.
+void frame_damage(const FrameState& a, const FrameState& b, const Layout& layout,
+                  const TextMetrics& tm, std::vector<XRectangle>& out);
+
+// A frame sink: an X window, an in-memory image, ...
+class Renderer {
+public:
+    virtual ~Renderer() = default;
+    virtual void render(const Game& game) = 0;
+};
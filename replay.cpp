@@ -0,0 +1,226 @@
+#include "replay.h"
+#include "history.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[4] = {'T','T','R','P'};
+constexpr std::size_t HEADER_SIZE = 16;
+
+void put_le(std::uint8_t* out, std::uint64_t v, int bytes){
+    for(int i=0;i<bytes;++i) out[i] = static_cast<std::uint8_t>(v >> (8*i));
+}
+
+std::uint64_t get_le(const std::uint8_t* in, int bytes){
+    std::uint64_t v = 0;
+    for(int i=0;i<bytes;++i) v |= std::uint64_t(in[i]) << (8*i);
+    return v;
+}
+
+bool has_payload(ReplayEvent ev){
+    return ev == ReplayEvent::Move || ev == ReplayEvent::Rewind;
+}
+
+struct Reader {
+    const std::uint8_t* p;
+    const std::uint8_t* end;
+
+    bool byte(std::uint8_t& out){
+        if(p >= end) return false;
+        out = *p++;
+        return true;
+    }
+    bool varint(std::uint64_t& out){
+        out = 0;
+        for(int shift=0; shift<64; shift+=7){
+            std::uint8_t b;
+            if(!byte(b)) return false;
+            out |= std::uint64_t(b & 0x7f) << shift;
+            if(!(b & 0x80)) return true;
+        }
+        return false;
+    }
+};
+
+} // namespace
+
+ReplayRecorder::~ReplayRecorder(){
+    if(fd >= 0){
+        flush();
+        ::close(fd);
+    }
+}
+
+bool ReplayRecorder::open(const char* path, std::uint64_t seed, Game::clock::time_point start){
+    fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return false;
+    std::uint8_t header[HEADER_SIZE] = {};
+    std::memcpy(header, MAGIC, 4);
+    put_le(header + 4, VERSION, 2);
+    put_le(header + 8, seed, 8);
+    for(auto b: header) put(b);
+    last = start;
+    return true;
+}
+
+void ReplayRecorder::put_varint(std::uint64_t v){
+    while(v >= 0x80){
+        put(static_cast<std::uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    put(static_cast<std::uint8_t>(v));
+}
+
+void ReplayRecorder::add(ReplayEvent ev, Game::clock::time_point t, int payload){
+    if(fd < 0) return;
+    auto dt = std::chrono::duration_cast<std::chrono::milliseconds>(t - last).count();
+    if(dt < 0) dt = 0;
+    last += std::chrono::milliseconds(dt);
+    put(static_cast<std::uint8_t>(ev));
+    if(has_payload(ev)) put(static_cast<std::uint8_t>(payload));
+    put_varint(static_cast<std::uint64_t>(dt));
+}
+
+void ReplayRecorder::flush(){
+    std::size_t done = 0;
+    while(fd >= 0 && done < len){
+        ssize_t n = ::write(fd, buf.data() + done, len - done);
+        if(n <= 0) break;
+        done += static_cast<std::size_t>(n);
+    }
+    len = 0;
+}
+
+void ReplayRecorder::finish(const Game& g){
+    if(fd < 0) return;
+    add(ReplayEvent::End, g.now);
+    put_varint(static_cast<std::uint64_t>(g.score));
+    put_varint(static_cast<std::uint64_t>(g.total_lines_cleared));
+    put_varint(static_cast<std::uint64_t>(g.pieces_placed));
+    std::uint8_t h[8];
+    put_le(h, g.board_hash, 8);
+    for(auto b: h) put(b);
+    flush();
+    ::close(fd);
+    fd = -1;
+}
+
+ReplayResult verify_replay(const std::uint8_t* data, std::size_t size,
+                           const ReplayObserver& observe){
+    ReplayResult res;
+    if(size < HEADER_SIZE || std::memcmp(data, MAGIC, 4) != 0){
+        res.error = "not a replay file";
+        return res;
+    }
+    if(get_le(data + 4, 2) != ReplayRecorder::VERSION){
+        res.error = "unsupported replay version";
+        return res;
+    }
+
+    Game game;
+    Game::clock::time_point t{};
+    game.set_time(t);
+    game.init(get_le(data + 8, 8));
+    // snapshots are taken exactly as the game loop takes them, so recorded
+    // rewinds land on the same state
+    History history;
+    history.push(game);
+
+    Reader rd{data + HEADER_SIZE, data + size};
+    std::uint8_t type;
+    while(rd.byte(type)){
+        auto ev = static_cast<ReplayEvent>(type);
+        std::uint8_t payload = 0;
+        std::uint64_t dt;
+        if((has_payload(ev) && !rd.byte(payload)) || !rd.varint(dt)){
+            res.error = "truncated record";
+            return res;
+        }
+        t += std::chrono::milliseconds(dt);
+        if(observe) observe(game, t);
+        game.set_time(t);
+        ++res.events;
+
+        switch(ev){
+        case ReplayEvent::Left:     game.try_move(-1, 0, 0); break;
+        case ReplayEvent::Right:    game.try_move(1, 0, 0); break;
+        case ReplayEvent::Down:     game.try_move(0, 1, 0); break;
+        case ReplayEvent::Rotate:   game.try_move(0, 0, 1); break;
+        case ReplayEvent::Move:
+            game.try_move((payload & 3) - 2, ((payload >> 2) & 3) - 2, (payload >> 4) & 3);
+            break;
+        case ReplayEvent::HardDrop: game.hard_drop(); break;
+        case ReplayEvent::Lock:     game.lock_piece(); break;
+        case ReplayEvent::Restart:
+            game.reset();
+            history.clear();
+            history.push(game);
+            break;
+        case ReplayEvent::Rewind:
+            if(!history.rewind(game, payload)){
+                res.error = "rewind past recorded history";
+                return res;
+            }
+            break;
+        case ReplayEvent::End: {
+            std::uint64_t score, lines, pieces;
+            if(!rd.varint(score) || !rd.varint(lines) || !rd.varint(pieces) || rd.end - rd.p < 8){
+                res.error = "truncated footer";
+                return res;
+            }
+            std::uint64_t hash = get_le(rd.p, 8);
+            res.score = game.score;
+            res.lines = game.total_lines_cleared;
+            res.pieces = game.pieces_placed;
+            res.hash = game.board_hash;
+            res.game_seconds = std::chrono::duration<double>(t.time_since_epoch()).count();
+            if(score != std::uint64_t(game.score) ||
+               lines != std::uint64_t(game.total_lines_cleared) ||
+               pieces != std::uint64_t(game.pieces_placed) ||
+               hash != game.board_hash)
+            {
+                res.error = "final state mismatch";
+                return res;
+            }
+            res.ok = true;
+            return res;
+        }
+        default:
+            res.error = "unknown record type";
+            return res;
+        }
+        history.sync(game);
+    }
+    res.error = "missing end record";
+    return res;
+}
+
+ReplayResult verify_replay_file(const char* path, const ReplayObserver& observe){
+    ReplayResult res;
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0){
+        res.error = "cannot open";
+        return res;
+    }
+    struct stat st{};
+    if(::fstat(fd, &st) != 0 || st.st_size == 0){
+        ::close(fd);
+        res.error = "empty file";
+        return res;
+    }
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED){
+        res.error = "mmap failed";
+        return res;
+    }
+    ::madvise(map, size, MADV_SEQUENTIAL);
+    res = verify_replay(static_cast<const std::uint8_t*>(map), size, observe);
+    ::munmap(map, size);
+    return res;
+}
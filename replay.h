@@ -0,0 +1,75 @@
+#pragma once
+
+#include "game.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Compact binary input log. A file is a 16-byte header (magic "TTRP",
+// version, seed) followed by records of one type byte, an optional payload
+// byte and the milliseconds since the previous record as a LEB128 varint.
+// Game emits a record for every state change (moves, drops, locks,
+// restarts, rewinds), so replaying the records on a Game seeded the same way
+// reproduces the session exactly, without any timers.
+enum class ReplayEvent : std::uint8_t {
+    Left = 1,
+    Right,
+    Down,       // soft drop or gravity step
+    Rotate,     // clockwise
+    Move,       // any other try_move; payload = packed dx, dy, dr
+    HardDrop,
+    Lock,
+    Restart,
+    End,        // footer: score, lines, pieces, board hash
+    Rewind,     // History::rewind; payload = snapshots stepped back (< 256)
+};
+
+class ReplayRecorder {
+public:
+    static constexpr std::uint16_t VERSION = 1;
+
+    ReplayRecorder() = default;
+    ~ReplayRecorder();
+    ReplayRecorder(const ReplayRecorder&) = delete;
+    ReplayRecorder& operator=(const ReplayRecorder&) = delete;
+
+    bool open(const char* path, std::uint64_t seed, Game::clock::time_point start);
+    bool is_open() const { return fd >= 0; }
+
+    // appends to an in-memory buffer; the disk only sees full buffers
+    void add(ReplayEvent ev, Game::clock::time_point t, int payload = -1);
+
+    // write the footer for the final state, flush and close
+    void finish(const Game& g);
+
+private:
+    void put(std::uint8_t b) { if(len == buf.size()) flush(); buf[len++] = b; }
+    void put_varint(std::uint64_t v);
+    void flush();
+
+    int fd = -1;
+    std::array<std::uint8_t,64*1024> buf{};
+    std::size_t len = 0;
+    Game::clock::time_point last{};
+};
+
+struct ReplayResult {
+    bool ok = false;
+    std::string error;
+    long long events = 0;
+    double game_seconds = 0;   // span of the recorded session
+    int score = 0, lines = 0, pieces = 0;
+    std::uint64_t hash = 0;
+};
+
+// called before each record is applied with the state so far and the
+// record's time, e.g. to render frames up to that time
+using ReplayObserver = std::function<void(const Game&, Game::clock::time_point)>;
+
+// re-simulate a log held in memory and check it against its footer
+ReplayResult verify_replay(const std::uint8_t* data, std::size_t size,
+                           const ReplayObserver& observe = nullptr);
+// same, for a file mapped into memory
+ReplayResult verify_replay_file(const char* path, const ReplayObserver& observe = nullptr);
@@ -0,0 +1,73 @@
+//
+// Replay verifier: memory-maps recorded sessions, re-simulates them at full
+// speed and checks final score, lines, piece count and board hash. Files
+// and whole directories are processed in parallel.
+//
+#include "replay.h"
+#include "thread_pool.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv){
+    namespace fs = std::filesystem;
+    unsigned threads = 0;
+    bool quiet = false;
+    std::vector<std::string> files;
+    for(int i=1;i<argc;++i){
+        if(!std::strcmp(argv[i], "--threads") && i+1 < argc){
+            threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if(!std::strcmp(argv[i], "--quiet")){
+            quiet = true;
+        } else if(argv[i][0] == '-'){
+            std::fprintf(stderr, "usage: %s [--threads N] [--quiet] FILE|DIR...\n", argv[0]);
+            return 2;
+        } else {
+            std::error_code ec;
+            if(fs::is_directory(argv[i], ec)){
+                for(const auto& e: fs::recursive_directory_iterator(argv[i], ec))
+                    if(e.is_regular_file() && e.path().extension() == ".ttr")
+                        files.push_back(e.path().string());
+            } else {
+                files.push_back(argv[i]);
+            }
+        }
+    }
+    if(files.empty()){
+        std::fprintf(stderr, "no replay files given\n");
+        return 2;
+    }
+
+    std::vector<ReplayResult> results(files.size());
+    ThreadPool pool(threads);
+    auto t0 = std::chrono::steady_clock::now();
+    pool.parallel_for(files.size(), [&](std::size_t i){
+        results[i] = verify_replay_file(files[i].c_str());
+    });
+    auto t1 = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+
+    int failed = 0;
+    long long events = 0;
+    double game_seconds = 0;
+    for(std::size_t i=0;i<files.size();++i){
+        const ReplayResult& r = results[i];
+        events += r.events;
+        game_seconds += r.game_seconds;
+        if(!r.ok) ++failed;
+        if(!r.ok || !quiet)
+            std::printf("%-4s %s: score %d, lines %d, pieces %d%s%s\n",
+                        r.ok ? "OK" : "FAIL", files[i].c_str(),
+                        r.score, r.lines, r.pieces,
+                        r.ok ? "" : " - ", r.error.c_str());
+    }
+    std::printf("%zu replays, %d failed, %lld events in %.3f s (%.0f events/sec, %.0fx real time)\n",
+                files.size(), failed, events, secs,
+                secs > 0 ? events / secs : 0.0,
+                secs > 0 ? game_seconds / secs : 0.0);
+    return failed ? 1 : 0;
+}
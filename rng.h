@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+// PCG32 (XSH-RR variant): 16 bytes of state, a handful of instructions per
+// draw and the same sequence on every platform and standard library, unlike
+// std::mt19937 (~5 KB) combined with std::shuffle (implementation defined).
+struct Rng {
+    using result_type = std::uint32_t;
+
+    std::uint64_t state = 0;
+    std::uint64_t inc = 1; // stream selector, always odd
+
+    Rng() { seed(0); }
+    explicit Rng(std::uint64_t s, std::uint64_t stream = 0) { seed(s, stream); }
+
+    void seed(std::uint64_t s, std::uint64_t stream = 0){
+        state = 0;
+        inc = (stream << 1) | 1u;
+        next();
+        state += s;
+        next();
+    }
+
+    std::uint32_t next(){
+        std::uint64_t old = state;
+        state = old * 6364136223846793005ull + inc;
+        std::uint32_t xorshifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+        std::uint32_t rot = static_cast<std::uint32_t>(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    // unbiased value in [0, bound) (Lemire's multiply-and-reject)
+    std::uint32_t below(std::uint32_t bound){
+        std::uint64_t m = std::uint64_t(next()) * bound;
+        std::uint32_t low = static_cast<std::uint32_t>(m);
+        if(low < bound){
+            std::uint32_t threshold = (0u - bound) % bound;
+            while(low < threshold){
+                m = std::uint64_t(next()) * bound;
+                low = static_cast<std::uint32_t>(m);
+            }
+        }
+        return static_cast<std::uint32_t>(m >> 32);
+    }
+
+    // Fisher-Yates from the back; fully specified, so bags are reproducible
+    template<class It>
+    void shuffle(It first, It last){
+        auto n = static_cast<std::uint32_t>(std::distance(first, last));
+        for(std::uint32_t i = n; i > 1; --i)
+            std::swap(first[i-1], first[below(i)]);
+    }
+
+    // UniformRandomBitGenerator, so <random> distributions still work
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xffffffffu; }
+    result_type operator()() { return next(); }
+};
@@ -0,0 +1,87 @@
+#include "telemetry.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void TelemetrySegment::publish(const TelemetryStats& s){
+    std::uint64_t w[WORDS];
+    std::memcpy(w, &s, sizeof(w));
+    std::uint32_t q = seq.load(std::memory_order_relaxed);
+    seq.store(q + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for(std::size_t i=0;i<WORDS;++i)
+        words[i].store(w[i], std::memory_order_relaxed);
+    seq.store(q + 2, std::memory_order_release);
+}
+
+bool TelemetrySegment::read(TelemetryStats& out, int tries) const{
+    std::uint64_t w[WORDS];
+    for(int t=0;t<tries;++t){
+        std::uint32_t q0 = seq.load(std::memory_order_acquire);
+        if(q0 & 1) continue;
+        for(std::size_t i=0;i<WORDS;++i)
+            w[i] = words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(seq.load(std::memory_order_relaxed) != q0) continue;
+        std::memcpy(&out, w, sizeof(out));
+        return true;
+    }
+    return false;
+}
+
+TelemetryPublisher::~TelemetryPublisher(){
+    close();
+}
+
+bool TelemetryPublisher::open(){
+    close();
+    std::snprintf(name, sizeof(name), "/tetris-%d", static_cast<int>(::getpid()));
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if(fd < 0) return false;
+    void* p = MAP_FAILED;
+    if(ftruncate(fd, sizeof(TelemetrySegment)) == 0)
+        p = mmap(nullptr, sizeof(TelemetrySegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(p == MAP_FAILED){
+        shm_unlink(name);
+        return false;
+    }
+    // fresh pages are zero: seq starts even, the header goes in last
+    seg = static_cast<TelemetrySegment*>(p);
+    seg->size = sizeof(TelemetrySegment);
+    seg->version = TelemetrySegment::VERSION;
+    std::atomic_thread_fence(std::memory_order_release);
+    seg->magic = TelemetrySegment::MAGIC;
+    return true;
+}
+
+void TelemetryPublisher::close(){
+    if(!seg) return;
+    munmap(seg, sizeof(TelemetrySegment));
+    shm_unlink(name);
+    seg = nullptr;
+}
+
+const TelemetrySegment* telemetry_map(const char* name){
+    int fd = shm_open(name, O_RDONLY, 0);
+    if(fd < 0) return nullptr;
+    struct stat st{};
+    void* p = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(TelemetrySegment))
+        p = mmap(nullptr, sizeof(TelemetrySegment), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(p == MAP_FAILED) return nullptr;
+    auto* seg = static_cast<const TelemetrySegment*>(p);
+    if(seg->magic != TelemetrySegment::MAGIC || seg->version != TelemetrySegment::VERSION ||
+       seg->size != sizeof(TelemetrySegment)){
+        munmap(p, sizeof(TelemetrySegment));
+        return nullptr;
+    }
+    return seg;
+}
+
+void telemetry_unmap(const TelemetrySegment* seg){
+    if(seg) munmap(const_cast<TelemetrySegment*>(seg), sizeof(TelemetrySegment));
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Live per-process statistics for external monitoring. Every tetris
+// process publishes one TelemetryStats in a POSIX shared memory segment
+// named /tetris-<pid>; tetris_top maps all of them read-only and reads
+// them in place.
+struct TelemetryStats {
+    std::int64_t pid;
+    std::int64_t score, level, lines, pieces;
+    double pieces_per_sec;             // in the current game
+    double frame_us_p50, frame_us_p99, frame_us_max;  // render() time
+    double requests_per_frame;         // X requests, mean over presented frames
+    std::int64_t frames;               // presented frames
+    std::int64_t wakeups, idle_wakeups;  // loop wakeups, those that drew nothing
+    std::int64_t game_overs;
+};
+
+// The segment: a header checked by readers, then the stats under a
+// seqlock. The writer bumps `seq` to odd, stores the payload words and
+// bumps it to even again, so publishing is wait-free; a reader retries
+// while `seq` is odd or changed under it. The payload is kept as relaxed
+// atomic words so concurrent access across processes is well defined.
+struct TelemetrySegment {
+    static constexpr std::uint32_t MAGIC = 0x4c455454;   // "TTEL"
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr std::size_t WORDS = sizeof(TelemetryStats) / 8;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t size;                // sizeof(TelemetrySegment) of the writer
+    std::atomic<std::uint32_t> seq;
+    std::array<std::atomic<std::uint64_t>,WORDS> words;
+
+    void publish(const TelemetryStats& s);
+    // false if no consistent snapshot was seen within `tries` attempts
+    bool read(TelemetryStats& out, int tries = 64) const;
+};
+
+static_assert(sizeof(TelemetryStats) % 8 == 0, "stats are copied as 64-bit words");
+static_assert(std::is_trivially_copyable<TelemetryStats>::value, "stats are copied as words");
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared atomics must be lock-free");
+
+// Owns this process's segment: creates it, publishes into it and unlinks
+// it again on close().
+class TelemetryPublisher {
+public:
+    TelemetryPublisher() = default;
+    ~TelemetryPublisher();
+    TelemetryPublisher(const TelemetryPublisher&) = delete;
+    TelemetryPublisher& operator=(const TelemetryPublisher&) = delete;
+
+    bool open();
+    void close();
+    bool is_open() const { return seg != nullptr; }
+
+    void publish(const TelemetryStats& s){ if(seg) seg->publish(s); }
+
+private:
+    TelemetrySegment* seg = nullptr;
+    char name[32] = {};
+};
+
+// read-only mapping of another process's segment, nullptr if `name` (e.g.
+// "/tetris-1234") is missing or not a compatible segment
+const TelemetrySegment* telemetry_map(const char* name);
+void telemetry_unmap(const TelemetrySegment* seg);
@@ -0,0 +1,90 @@
+#include "thread_pool.h"
+#include "trace.h"
+
+ThreadPool::ThreadPool(unsigned threads){
+    if(threads == 0) threads = std::thread::hardware_concurrency();
+    if(threads == 0) threads = 1;
+    for(unsigned i=0;i<=threads;++i)
+        queues.push_back(std::make_unique<Queue>());
+    for(unsigned i=0;i<threads;++i)
+        workers.emplace_back([this, i]{ worker_loop(i); });
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> lk(wake_m);
+        stopping = true;
+    }
+    wake_cv.notify_all();
+    for(auto& t: workers) t.join();
+}
+
+void ThreadPool::submit(std::function<void()> task){
+    std::size_t q = next_queue.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        // count before publishing so `queued` never drops below the real number
+        std::lock_guard<std::mutex> lk(wake_m);
+        queued.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lk(queues[q]->m);
+        queues[q]->tasks.push_back(std::move(task));
+    }
+    wake_cv.notify_one();
+}
+
+bool ThreadPool::try_run(std::size_t self){
+    std::function<void()> task;
+    {
+        // own queue first (LIFO keeps caches warm) ...
+        std::lock_guard<std::mutex> lk(queues[self]->m);
+        auto& own = queues[self]->tasks;
+        if(!own.empty()){
+            task = std::move(own.back());
+            own.pop_back();
+        }
+    }
+    // ... then steal the oldest task of a victim
+    for(std::size_t i=1; !task && i<queues.size(); ++i){
+        Queue& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lk(victim.m);
+        if(!victim.tasks.empty()){
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+    if(!task) return false;
+
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    task();
+    if(pending.fetch_sub(1, std::memory_order_acq_rel) == 1){
+        std::lock_guard<std::mutex> lk(wake_m);
+        done_cv.notify_all();
+    }
+    return true;
+}
+
+void ThreadPool::worker_loop(std::size_t self){
+    TRACE_THREAD();
+    while(true){
+        if(try_run(self)) continue;
+        std::unique_lock<std::mutex> lk(wake_m);
+        wake_cv.wait(lk, [this]{
+            return stopping || queued.load(std::memory_order_relaxed) > 0;
+        });
+        if(stopping) return;
+    }
+}
+
+void ThreadPool::wait(){
+    std::size_t self = queues.size() - 1;
+    while(pending.load(std::memory_order_acquire) > 0){
+        if(try_run(self)) continue;
+        std::unique_lock<std::mutex> lk(wake_m);
+        done_cv.wait(lk, [this]{
+            return pending.load(std::memory_order_acquire) == 0 ||
+                   queued.load(std::memory_order_relaxed) > 0;
+        });
+    }
+}
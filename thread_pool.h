@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool: every worker owns a deque, pops from its back
+// and steals from the front of the others when it runs dry. The thread that
+// calls wait() helps out instead of sleeping.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads = 0); // 0 = one per hardware thread
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    void submit(std::function<void()> task);
+    void wait(); // until every submitted task has finished
+
+    // run fn(0..count-1) across the pool and wait for all of them
+    template<class Fn>
+    void parallel_for(std::size_t count, Fn fn){
+        for(std::size_t i=0;i<count;++i)
+            submit([&fn, i]{ fn(i); });
+        wait();
+    }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool try_run(std::size_t self);
+    void worker_loop(std::size_t self);
+
+    std::vector<std::unique_ptr<Queue>> queues; // one per worker + one for the caller
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> next_queue{0};
+    std::atomic<std::size_t> queued{0};   // submitted, not yet started
+    std::atomic<std::size_t> pending{0};  // submitted, not yet finished
+
+    std::mutex wake_m;
+    std::condition_variable wake_cv;
+    std::condition_variable done_cv;
+    bool stopping = false;
+};
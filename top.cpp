@@ -0,0 +1,104 @@
+//
+// Live table of every running tetris instance: maps each /tetris-<pid>
+// shared memory segment read-only once and reads its seqlocked stats in
+// place on every refresh. The owner is the pid in the segment name:
+// segments of processes that are gone (killed before they could unlink)
+// are not mapped, and instances that have not published their first
+// stats yet are not listed.
+//
+#include "telemetry.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <map>
+#include <string>
+
+namespace {
+
+// owner pid from a "/tetris-<pid>" name, 0 if it is not one
+pid_t owner_pid(const std::string& name){
+    const char* digits = name.c_str() + std::strlen("/tetris-");
+    char* end = nullptr;
+    long pid = std::strtol(digits, &end, 10);
+    return end != digits && !*end && pid > 0 ? static_cast<pid_t>(pid) : 0;
+}
+
+bool alive(pid_t pid){
+    return ::kill(pid, 0) == 0 || errno == EPERM;
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+    namespace fs = std::filesystem;
+    int interval_ms = 1000;
+    bool once = false;
+    for(int i=1;i<argc;++i){
+        if(!std::strcmp(argv[i], "--interval") && i+1 < argc) interval_ms = std::atoi(argv[++i]);
+        else if(!std::strcmp(argv[i], "--once")) once = true;
+        else {
+            std::fprintf(stderr, "usage: %s [--interval MS] [--once]\n", argv[0]);
+            return 2;
+        }
+    }
+    if(interval_ms < 10) interval_ms = 10;
+
+    std::map<std::string, const TelemetrySegment*> segments;   // by shm name
+    while(true){
+        // pick up new instances; POSIX shm names live in /dev/shm on Linux
+        std::error_code ec;
+        for(const auto& e: fs::directory_iterator("/dev/shm", ec)){
+            std::string file = e.path().filename().string();
+            if(file.rfind("tetris-", 0) != 0) continue;
+            std::string name = "/" + file;
+            if(segments.count(name)) continue;
+            // a kill(pid, 0) probe is all a stale segment costs per refresh
+            pid_t pid = owner_pid(name);
+            if(!pid || !alive(pid)) continue;
+            if(const TelemetrySegment* seg = telemetry_map(name.c_str()))
+                segments[name] = seg;
+        }
+
+        if(!once) std::printf("\033[H\033[2J");
+        std::printf("%7s %8s %5s %6s %6s %7s %22s %7s %9s %9s %5s\n",
+                    "PID", "SCORE", "LEVEL", "LINES", "PIECES", "PPS",
+                    "FRAME us p50/p99/max", "REQ/F", "WAKEUPS", "IDLE", "OVERS");
+        int listed = 0;
+        for(auto it = segments.begin(); it != segments.end();){
+            if(!alive(owner_pid(it->first)) || !fs::exists("/dev/shm" + it->first, ec)){
+                telemetry_unmap(it->second);
+                it = segments.erase(it);
+                continue;
+            }
+            // pid 0: the owner has not published yet
+            TelemetryStats s{};
+            if(!it->second->read(s) || s.pid == 0){
+                ++it;
+                continue;
+            }
+            char frame[32];
+            std::snprintf(frame, sizeof(frame), "%.0f/%.0f/%.0f",
+                          s.frame_us_p50, s.frame_us_p99, s.frame_us_max);
+            std::printf("%7lld %8lld %5lld %6lld %6lld %7.2f %22s %7.1f %9lld %9lld %5lld\n",
+                        static_cast<long long>(s.pid), static_cast<long long>(s.score),
+                        static_cast<long long>(s.level), static_cast<long long>(s.lines),
+                        static_cast<long long>(s.pieces), s.pieces_per_sec, frame,
+                        s.requests_per_frame, static_cast<long long>(s.wakeups),
+                        static_cast<long long>(s.idle_wakeups), static_cast<long long>(s.game_overs));
+            ++listed;
+            ++it;
+        }
+        if(!listed) std::printf("(no running instances)\n");
+        std::fflush(stdout);
+        if(once) break;
+        timespec ts{interval_ms / 1000, (interval_ms % 1000) * 1'000'000L};
+        nanosleep(&ts, nullptr);
+    }
+    for(auto& [name, seg]: segments) telemetry_unmap(seg);
+    return 0;
+}
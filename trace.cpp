@@ -0,0 +1,83 @@
+#include "trace.h"
+
+#if TETRIS_TRACE
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace trace {
+namespace {
+
+struct Event {
+    const char* name;
+    std::int64_t start_ns, dur_ns;
+};
+
+// written only by its thread; `count` is read by the exporter
+struct Ring {
+    int tid = 0;
+    std::uint64_t count = 0;   // events ever recorded
+    std::unique_ptr<Event[]> events{new Event[RING_EVENTS]};
+};
+
+// rings outlive their threads, so events of finished threads are exported too
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<Ring>>& registry(){
+    static std::vector<std::unique_ptr<Ring>> rings;
+    return rings;
+}
+
+thread_local Ring* thread_ring = nullptr;
+
+const std::int64_t epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+
+} // namespace
+
+std::int64_t now_ns(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count() - epoch;
+}
+
+void register_thread(){
+    if(thread_ring) return;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto& rings = registry();
+    rings.push_back(std::make_unique<Ring>());
+    rings.back()->tid = static_cast<int>(rings.size());
+    thread_ring = rings.back().get();
+}
+
+void record(const char* name, std::int64_t start_ns, std::int64_t dur_ns){
+    if(!thread_ring) register_thread();
+    Ring* ring = thread_ring;
+    ring->events[ring->count++ & (RING_EVENTS - 1)] = Event{name, start_ns, dur_ns};
+}
+
+bool write_chrome_json(const char* path){
+    std::FILE* fp = std::fopen(path, "w");
+    if(!fp) return false;
+    std::fprintf(fp, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    bool first = true;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for(const auto& ring: registry()){
+        std::uint64_t n = ring->count;
+        std::uint64_t from = n > RING_EVENTS ? n - RING_EVENTS : 0;
+        for(std::uint64_t i=from;i<n;++i){
+            const Event& e = ring->events[i & (RING_EVENTS - 1)];
+            std::fprintf(fp, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                             "\"ts\": %.3f, \"dur\": %.3f}",
+                         first ? "" : ",\n", e.name, ring->tid, e.start_ns / 1e3, e.dur_ns / 1e3);
+            first = false;
+        }
+    }
+    std::fprintf(fp, "\n]}\n");
+    return std::fclose(fp) == 0;
+}
+
+} // namespace trace
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+// Opt-in scoped-timer tracing, compiled in with the TETRIS_TRACE CMake
+// option. Each thread records complete events (name, start, duration)
+// into its own fixed ring buffer, so recording takes no locks and the
+// newest events win when a ring wraps; write_chrome_json() exports every
+// thread's ring in Chrome trace-event format (chrome://tracing, Perfetto).
+// Without the option the macros expand to nothing.
+//
+// A ring is allocated on a thread's first event unless the thread claimed
+// it up front with TRACE_THREAD(); threads on allocation-free paths (main,
+// pool workers) do, so tracing never allocates mid-game.
+//
+//   TRACE_SCOPE("lock_piece");          // times the enclosing scope
+//   TRACE_PHASES(ph, "grid");           // sequential phases of one scope:
+//   TRACE_NEXT(ph, "field");            // ends "grid", starts "field"
+//   TRACE_THREAD();                     // allocate this thread's ring now
+
+#if TETRIS_TRACE
+
+#include <cstdint>
+
+namespace trace {
+
+constexpr int RING_EVENTS = 1 << 16;   // per thread
+
+std::int64_t now_ns();
+void register_thread();   // idempotent
+// names must be string literals (only the pointer is stored)
+void record(const char* name, std::int64_t start_ns, std::int64_t dur_ns);
+// call once the other threads are idle; false if the file cannot be written
+bool write_chrome_json(const char* path);
+
+class Scope {
+public:
+    explicit Scope(const char* n) : name(n), start(now_ns()) {}
+    ~Scope(){ record(name, start, now_ns() - start); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name;
+    std::int64_t start;
+};
+
+class Phases {
+public:
+    explicit Phases(const char* n) : name(n), start(now_ns()) {}
+    ~Phases(){ record(name, start, now_ns() - start); }
+    Phases(const Phases&) = delete;
+    Phases& operator=(const Phases&) = delete;
+
+    void next(const char* n){
+        std::int64_t t = now_ns();
+        record(name, start, t - start);
+        name = n;
+        start = t;
+    }
+
+private:
+    const char* name;
+    std::int64_t start;
+};
+
+} // namespace trace
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) ::trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_PHASES(var, name) ::trace::Phases var(name)
+#define TRACE_NEXT(var, name) var.next(name)
+#define TRACE_THREAD() ::trace::register_thread()
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_PHASES(var, name) ((void)0)
+#define TRACE_NEXT(var, name) ((void)0)
+#define TRACE_THREAD() ((void)0)
+
+#endif
@@ -0,0 +1,57 @@
+#include "tt.h"
+#include <cstring>
+
+TranspositionTable::TranspositionTable(std::size_t megabytes){
+    // largest power of two that fits the budget, so indexing is a mask
+    std::size_t budget = megabytes * 1024 * 1024 / sizeof(Slot);
+    slot_count = 1;
+    while(slot_count * 2 <= budget) slot_count *= 2;
+    table = std::make_unique<Slot[]>(slot_count);
+}
+
+// layout: score (float bits) | depth:8 | x+8:8 | r:8 | valid:8
+std::uint64_t TranspositionTable::pack(const Entry& e){
+    std::uint32_t bits;
+    std::memcpy(&bits, &e.score, sizeof bits);
+    return (std::uint64_t(bits) << 32) |
+           (std::uint64_t(e.depth & 0xff) << 24) |
+           (std::uint64_t((e.x + 8) & 0xff) << 16) |
+           (std::uint64_t(e.r & 0xff) << 8) |
+           1u;
+}
+
+TranspositionTable::Entry TranspositionTable::unpack(std::uint64_t d){
+    Entry e;
+    std::uint32_t bits = static_cast<std::uint32_t>(d >> 32);
+    std::memcpy(&e.score, &bits, sizeof bits);
+    e.depth = static_cast<int>((d >> 24) & 0xff);
+    e.x = static_cast<int>((d >> 16) & 0xff) - 8;
+    e.r = static_cast<int>((d >> 8) & 0xff);
+    return e;
+}
+
+bool TranspositionTable::probe(std::uint64_t key, int depth, Entry& out) const{
+    Slot& s = table[key & (slot_count - 1)];
+    std::uint64_t data = s.data.load(std::memory_order_relaxed);
+    std::uint64_t check = s.check.load(std::memory_order_relaxed);
+    if(!(data & 1) || (check ^ data) != key) return false;
+    Entry e = unpack(data);
+    if(e.depth != depth) return false;
+    out = e;
+    return true;
+}
+
+void TranspositionTable::store(std::uint64_t key, const Entry& e){
+    // always replace: entries are cheap to recompute and recent ones are hot
+    Slot& s = table[key & (slot_count - 1)];
+    std::uint64_t data = pack(e);
+    s.check.store(key ^ data, std::memory_order_relaxed);
+    s.data.store(data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear(){
+    for(std::size_t i=0;i<slot_count;++i){
+        table[i].check.store(0, std::memory_order_relaxed);
+        table[i].data.store(0, std::memory_order_relaxed);
+    }
+}
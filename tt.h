@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Fixed-size, lock-free transposition table shared by the search threads.
+// A slot holds (key ^ data, data) in two relaxed atomics; a torn write from
+// a racing store breaks the XOR check and the probe just misses, so no locks
+// are needed (lockless hashing, as used by chess engines). Hit counting is
+// left to the caller so threads don't share a counter cache line.
+class TranspositionTable {
+public:
+    struct Entry {
+        float score = 0;
+        int depth = 0; // plies searched below the node
+        int x = 0, r = 0; // best placement at the node
+    };
+
+    explicit TranspositionTable(std::size_t megabytes);
+
+    bool probe(std::uint64_t key, int depth, Entry& out) const;
+    void store(std::uint64_t key, const Entry& e);
+    void clear();
+
+    std::size_t bytes() const { return slot_count * sizeof(Slot); }
+    std::size_t slots() const { return slot_count; }
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> check{0}; // key ^ data
+        std::atomic<std::uint64_t> data{0};
+    };
+
+    static std::uint64_t pack(const Entry& e);
+    static Entry unpack(std::uint64_t d);
+
+    std::unique_ptr<Slot[]> table;
+    std::size_t slot_count = 0;
+};
@@ -0,0 +1,229 @@
+//
+// Heuristic weight tuner: cross-entropy method over Ai::Weights. Every
+// candidate of a generation plays the same seeded games, all games of the
+// generation run in parallel. Each generation's winner and the final mean
+// are re-scored on one fixed validation seed set, and the best of those is
+// written to a file that `tetris --weights FILE` and `tetris_bench
+// --weights FILE` load.
+//
+#include "ai.h"
+#include "game.h"
+#include "rng.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr int DIMS = 4;
+using Vector = std::array<double,DIMS>;
+
+struct Options {
+    int generations = 20;
+    int population = 32;
+    int games = 100;        // per candidate
+    int max_pieces = 500;
+    double elite = 0.25;    // fraction of candidates kept each generation
+    unsigned threads = 0;
+    std::uint32_t seed = 1;
+    const char* out = "weights.txt";
+};
+
+Vector to_vector(const Ai::Weights& w){
+    return {w.height, w.lines, w.holes, w.bumpiness};
+}
+
+Ai::Weights to_weights(const Vector& v){
+    Ai::Weights w;
+    w.height = v[0];
+    w.lines = v[1];
+    w.holes = v[2];
+    w.bumpiness = v[3];
+    return w;
+}
+
+// Standard normal draws from the PCG32 Rng via Box-Muller. Unlike
+// std::normal_distribution, the algorithm is fixed, so a seeded run samples
+// the same candidates with every standard library.
+struct Normal {
+    Rng rng;
+    double spare = 0;
+    bool has_spare = false;
+
+    explicit Normal(std::uint64_t seed) : rng(seed) {}
+
+    double operator()(){
+        if(has_spare){
+            has_spare = false;
+            return spare;
+        }
+        // u1 in (0, 1) so the log is finite
+        double u1 = (rng.next() + 0.5) / 4294967296.0;
+        double u2 = rng.next() / 4294967296.0;
+        double radius = std::sqrt(-2.0 * std::log(u1));
+        double angle = 2.0 * 3.14159265358979323846 * u2;
+        spare = radius * std::sin(angle);
+        has_spare = true;
+        return radius * std::cos(angle);
+    }
+};
+
+// lines cleared in one seeded game with the greedy one-piece policy
+int play(const Ai::Weights& w, std::uint32_t seed, int max_pieces){
+    Game game;
+    game.init(seed);
+    Ai ai(1);
+    ai.depth = 1;
+    ai.weights = w;
+    for(int n=0; n<max_pieces && !game.over; ++n){
+        Ai::apply(game, ai.choose(game));
+        game.lock_piece();
+    }
+    return game.total_lines_cleared;
+}
+
+// mean lines over one fixed seed set that no generation trains on, so
+// candidates from different generations are compared on the same games
+double validate(ThreadPool& pool, const Ai::Weights& w, const Options& opt){
+    std::uint32_t seed = opt.seed * 7919u - 1000003u;  // "generation -1"
+    std::vector<int> lines(opt.games);
+    pool.parallel_for(lines.size(), [&](std::size_t g){
+        lines[g] = play(w, seed + static_cast<std::uint32_t>(g), opt.max_pieces);
+    });
+    long long sum = 0;
+    for(int l: lines) sum += l;
+    return double(sum) / opt.games;
+}
+
+Options parse(int argc, char** argv){
+    Options opt;
+    for(int i=1;i<argc;++i){
+        auto arg = [&](const char* name){ return !std::strcmp(argv[i], name) && i+1 < argc; };
+        if(arg("--generations")) opt.generations = std::atoi(argv[++i]);
+        else if(arg("--population")) opt.population = std::atoi(argv[++i]);
+        else if(arg("--games")) opt.games = std::atoi(argv[++i]);
+        else if(arg("--max-pieces")) opt.max_pieces = std::atoi(argv[++i]);
+        else if(arg("--elite")) opt.elite = std::atof(argv[++i]);
+        else if(arg("--threads")) opt.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if(arg("--seed")) opt.seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if(arg("--out")) opt.out = argv[++i];
+        else {
+            std::fprintf(stderr,
+                "usage: %s [--generations N] [--population N] [--games N] [--max-pieces N]\n"
+                "          [--elite F] [--threads N] [--seed N] [--out FILE]\n", argv[0]);
+            std::exit(2);
+        }
+    }
+    if(opt.population < 2) opt.population = 2;
+    const char* bad = nullptr;
+    if(opt.generations < 1) bad = "--generations must be at least 1";
+    else if(opt.games < 1) bad = "--games must be at least 1";
+    else if(opt.max_pieces < 1) bad = "--max-pieces must be at least 1";
+    else if(!(opt.elite > 0 && opt.elite <= 1)) bad = "--elite must be in (0, 1]";
+    if(bad){
+        std::fprintf(stderr, "%s: %s\n", argv[0], bad);
+        std::exit(2);
+    }
+    return opt;
+}
+
+} // namespace
+
+int main(int argc, char** argv){
+    Options opt = parse(argc, argv);
+    ThreadPool pool(opt.threads);
+    Normal normal(opt.seed);
+
+    Vector mean = to_vector(Ai::Weights{});
+    Vector sigma;
+    sigma.fill(0.5);
+    int elite_count = std::max(1, static_cast<int>(opt.population * opt.elite));
+
+    Ai::Weights best_weights;
+    double best_fitness = -1;
+    std::vector<Vector> candidates(opt.population);
+    std::vector<int> lines(static_cast<size_t>(opt.population) * opt.games);
+    std::vector<double> fitness(opt.population);
+    std::vector<int> order(opt.population);
+
+    std::printf("gen  best_lines  mean_lines  validated  wall_s  games/s/core\n");
+    for(int gen=0; gen<opt.generations; ++gen){
+        for(auto& c: candidates)
+            for(int d=0;d<DIMS;++d)
+                c[d] = mean[d] + sigma[d] * normal();
+
+        // one seed set per generation, shared by every candidate for fairness
+        std::uint32_t gen_seed = opt.seed * 7919u + static_cast<std::uint32_t>(gen) * 1000003u;
+
+        auto t0 = std::chrono::steady_clock::now();
+        pool.parallel_for(lines.size(), [&](std::size_t job){
+            size_t cand = job / opt.games;
+            std::uint32_t game_seed = gen_seed + static_cast<std::uint32_t>(job % opt.games);
+            lines[job] = play(to_weights(candidates[cand]), game_seed, opt.max_pieces);
+        });
+        auto t1 = std::chrono::steady_clock::now();
+        double secs = std::chrono::duration<double>(t1 - t0).count();
+
+        double mean_fitness = 0;
+        for(int c=0;c<opt.population;++c){
+            long long sum = 0;
+            for(int g=0;g<opt.games;++g) sum += lines[static_cast<size_t>(c) * opt.games + g];
+            fitness[c] = double(sum) / opt.games;
+            mean_fitness += fitness[c];
+        }
+        mean_fitness /= opt.population;
+
+        for(int c=0;c<opt.population;++c) order[c] = c;
+        std::sort(order.begin(), order.end(),
+                  [&](int a,int b){ return fitness[a] > fitness[b]; });
+        // each generation trains on other games: keep the winner that does
+        // best on the shared validation set, not the luckiest training score
+        Ai::Weights top = to_weights(candidates[order[0]]);
+        double validated = validate(pool, top, opt);
+        if(validated > best_fitness){
+            best_fitness = validated;
+            best_weights = top;
+        }
+
+        // refit the sampling distribution to the elite, with a little extra
+        // noise so it does not collapse early
+        for(int d=0;d<DIMS;++d){
+            double m = 0, v = 0;
+            for(int e=0;e<elite_count;++e) m += candidates[order[e]][d];
+            m /= elite_count;
+            for(int e=0;e<elite_count;++e){
+                double diff = candidates[order[e]][d] - m;
+                v += diff * diff;
+            }
+            mean[d] = m;
+            sigma[d] = std::sqrt(v / elite_count) + 0.05 / (gen + 1);
+        }
+
+        std::printf("%3d  %10.1f  %10.1f  %9.1f  %6.2f  %12.1f\n",
+                    gen, fitness[order[0]], mean_fitness, validated, secs,
+                    lines.size() / secs / pool.size());
+        std::fflush(stdout);
+    }
+
+    // the final distribution mean is a candidate as well
+    Ai::Weights final_mean = to_weights(mean);
+    double validated = validate(pool, final_mean, opt);
+    if(validated > best_fitness){
+        best_fitness = validated;
+        best_weights = final_mean;
+    }
+
+    if(!Ai::save_weights(opt.out, best_weights)){
+        std::perror(opt.out);
+        return 1;
+    }
+    std::printf("best: %.1f lines/game on the validation games, weights written to %s\n",
+                best_fitness, opt.out);
+    return 0;
+}